@@ -0,0 +1,131 @@
+#!/bin/sh
+# Build script for Linux (gcc or clang)
+# This script builds jr (Java Runner) for POSIX systems
+
+cd "$(dirname "$0")"
+
+CC=${CC:-cc}
+# Warnings are on for every build so new ones show up
+WARN_CFLAGS="-Wall -Wextra"
+
+# Optional in-process JVM hosting (launch.mode=jni) needs jni.h from a JDK
+JNI_CFLAGS=
+JNI_LIBS=
+if [ -n "$JAVA_HOME" ] && [ -f "$JAVA_HOME/include/jni.h" ]; then
+    JNI_CFLAGS="-DJR_JNI_HOSTING -I$JAVA_HOME/include -I$JAVA_HOME/include/linux -pthread"
+    JNI_LIBS="-ldl"
+    echo "JNI hosting enabled (jni.h from $JAVA_HOME)"
+fi
+
+echo "Building jr (dynamic libc) with $CC..."
+echo
+
+# Optimize for size: -Os (size) -ffunction-sections/-fdata-sections + --gc-sections (remove unused)
+# -s strips symbols, same intent as /OPT:REF /OPT:ICF in build-win.bat
+$CC $WARN_CFLAGS -Os -s -ffunction-sections -fdata-sections -Wl,--gc-sections $JNI_CFLAGS -o jr launcher.c $JNI_LIBS
+
+if [ $? -ne 0 ]; then
+    echo
+    echo "========================================"
+    echo "BUILD FAILED: jr"
+    echo "========================================"
+    echo "Please ensure gcc or clang is installed (set CC to override)."
+    echo
+    exit 1
+fi
+
+echo
+echo "========================================"
+echo "BUILD 1 SUCCESSFUL: jr"
+echo "========================================"
+ls -l jr
+echo
+# Build 2: Static version (standalone, no dynamic loader work at startup)
+# Prefers musl (tiny static libc with minimal init); falls back to $CC -static (glibc).
+# JNI hosting is left out: dlopen from a static binary is not reliable.
+if command -v musl-gcc >/dev/null 2>&1; then
+    STATIC_CC=musl-gcc
+else
+    STATIC_CC="$CC"
+fi
+
+# Budgets (override via environment); the build fails when either is exceeded
+SIZE_BUDGET=${JR_SIZE_BUDGET:-1048576}          # bytes
+LATENCY_BUDGET=${JR_LATENCY_BUDGET:-2000}       # microseconds per launch
+LATENCY_RUNS=${JR_LATENCY_RUNS:-200}
+
+echo "Building jr-standalone (static) with $STATIC_CC..."
+echo
+
+$STATIC_CC $WARN_CFLAGS -static -Os -s -ffunction-sections -fdata-sections -fno-asynchronous-unwind-tables \
+    -Wl,--gc-sections -o jr-standalone launcher.c
+
+if [ $? -ne 0 ]; then
+    echo
+    echo "========================================"
+    echo "BUILD FAILED: jr-standalone"
+    echo "========================================"
+    echo "A static libc is required (install musl-tools or glibc static libraries)."
+    echo
+    exit 1
+fi
+
+echo
+echo "========================================"
+echo "BUILD 2 SUCCESSFUL: jr-standalone"
+echo "========================================"
+ls -l jr-standalone
+echo
+
+# Measure exec-to-spawn latency: launch a no-op "java" through jr-standalone and
+# subtract the cost of launching the same no-op directly (includes exec, libc init,
+# launcher logic, spawn and wait)
+BENCH_DIR=$(mktemp -d)
+mkdir -p "$BENCH_DIR/bin"
+echo 'int main(void) { return 0; }' | $CC -x c -o "$BENCH_DIR/bin/java" -
+
+now_ns() { date +%s%N; }
+
+START=$(now_ns)
+i=0
+while [ $i -lt $LATENCY_RUNS ]; do
+    "$BENCH_DIR/bin/java" --disable-aot bench.jar
+    i=$((i + 1))
+done
+BASELINE_NS=$(( $(now_ns) - START ))
+
+START=$(now_ns)
+i=0
+while [ $i -lt $LATENCY_RUNS ]; do
+    ./jr-standalone --java-home="$BENCH_DIR" --disable-aot bench.jar
+    i=$((i + 1))
+done
+LAUNCHER_NS=$(( $(now_ns) - START ))
+
+rm -rf "$BENCH_DIR"
+
+SIZE=$(wc -c < jr-standalone | tr -d ' ')
+LATENCY=$(( (LAUNCHER_NS - BASELINE_NS) / LATENCY_RUNS / 1000 ))
+if [ $LATENCY -lt 0 ]; then LATENCY=0; fi
+
+# Record results next to the binary for tracking across builds
+echo "$(date '+%Y-%m-%d %H:%M:%S') cc=$STATIC_CC size=$SIZE bytes latency=$LATENCY us runs=$LATENCY_RUNS" >> jr-standalone.stats
+
+echo "Binary size:           $SIZE bytes (budget: $SIZE_BUDGET)"
+echo "Exec-to-spawn latency: $LATENCY us (budget: $LATENCY_BUDGET, $LATENCY_RUNS runs)"
+echo
+
+if [ $SIZE -gt $SIZE_BUDGET ] || [ $LATENCY -gt $LATENCY_BUDGET ]; then
+    echo "========================================"
+    echo "BUDGET EXCEEDED: jr-standalone"
+    echo "========================================"
+    exit 1
+fi
+
+echo
+echo "========================================"
+echo "ALL BUILDS SUCCESSFUL"
+echo "========================================"
+echo "jr            - Dynamic libc"
+echo "jr-standalone - Static ($STATIC_CC), no dynamic loader"
+echo
@@ -12,13 +12,20 @@ if %ERRORLEVEL% NEQ 0 (
     echo.
 )
 
+REM Optional in-process JVM hosting (launch.mode=jni) needs jni.h from a JDK
+set JNI_FLAGS=
+if defined JAVA_HOME if exist "%JAVA_HOME%\include\jni.h" (
+    set JNI_FLAGS=/DJR_JNI_HOSTING /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32"
+    echo JNI hosting enabled ^(jni.h from %JAVA_HOME%^)
+)
+
 echo Building jr.exe (dynamic CRT) with MSVC...
 echo.
 
 REM Build 1: Dynamic CRT version (small, requires VCREDIST)
 REM Optimize for size: /O1 (size) /GS- (no security checks) /Gy (function-level linking) /MD (dynamic CRT)
 REM Link flags: /OPT:REF (remove unused) /OPT:ICF (merge identical) /MERGE:.rdata=.text
-cl /nologo /O1 /GS- /Gy /MD /Fe:jr.exe launcher.c /link /SUBSYSTEM:CONSOLE /OPT:REF /OPT:ICF /MERGE:.rdata=.text user32.lib kernel32.lib
+cl /nologo /O1 /GS- /Gy /MD %JNI_FLAGS% /Fe:jr.exe launcher.c /link /SUBSYSTEM:CONSOLE /OPT:REF /OPT:ICF /MERGE:.rdata=.text user32.lib kernel32.lib ws2_32.lib
 
 if %ERRORLEVEL% NEQ 0 (
     echo.
@@ -46,7 +53,7 @@ echo.
 
 REM Build 2: Static CRT version (standalone, no dependencies)
 REM /MT = static CRT (no VCREDIST needed)
-cl /nologo /O1 /GS- /Gy /MT /Fe:jr-standalone.exe launcher.c /link /SUBSYSTEM:CONSOLE /OPT:REF /OPT:ICF /MERGE:.rdata=.text user32.lib kernel32.lib
+cl /nologo /O1 /GS- /Gy /MT %JNI_FLAGS% /Fe:jr-standalone.exe launcher.c /link /SUBSYSTEM:CONSOLE /OPT:REF /OPT:ICF /MERGE:.rdata=.text user32.lib kernel32.lib ws2_32.lib
 
 if %ERRORLEVEL% NEQ 0 (
     echo.
@@ -0,0 +1,201 @@
+package jarrunner;
+
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.lang.management.ManagementFactory;
+import java.util.Map;
+
+/**
+ * Companion helper for applications started by jr (Java Runner).
+ * Copy this file into your sources (package jarrunner) or put it on the class path;
+ * it has no dependencies and does nothing when the app was not started by jr.
+ */
+public final class JarRunner {
+
+    // Launch served by a warm JVM server (server=true), set by JarRunnerServer for the
+    // threads of one run; unset when the app has a JVM of its own
+    static final InheritableThreadLocal<String> sessionDirectory = new InheritableThreadLocal<>();
+    static final InheritableThreadLocal<Map<String, String>> sessionEnvironment = new InheritableThreadLocal<>();
+
+    private static boolean readySent;
+    private static long mainNanos = -1;
+    private static long readyNanos = -1;
+
+    private JarRunner() {
+    }
+
+    /**
+     * Marks the start of main() for {@link #timings()}. Call it first thing in main.
+     */
+    public static synchronized void mainStarted() {
+        if (mainNanos < 0) {
+            mainNanos = System.nanoTime();
+        }
+    }
+
+    /**
+     * Tells the launcher that the application finished initializing
+     * (ready.signal=true or ready.notify=true in the .jrc file) and marks the
+     * ready point for {@link #timings()}. Only the first call is reported.
+     * With crac=true, the first run of a JAR version takes its CRaC checkpoint here
+     * and later runs continue from this call.
+     *
+     * @return true if a waiting launcher was signalled
+     */
+    public static synchronized boolean ready() {
+        if (readySent) {
+            return false;
+        }
+        readySent = true;
+        readyNanos = System.nanoTime();
+
+        if (Boolean.getBoolean("jarrunner.crac.checkpoint")) {
+            if (checkpoint()) {
+                // Restored: main ran in the checkpointed process, whose nanoTime values
+                // mean nothing to this launch; it became ready when the restore finished
+                mainNanos = -1;
+                readyNanos = System.nanoTime();
+            }
+            return false;
+        }
+
+        String channel = readyChannelPath();
+        if (channel == null) {
+            return false;
+        }
+        try (FileOutputStream out = new FileOutputStream(channel)) {
+            out.write('R');
+            return true;
+        } catch (IOException e) {
+            return false;
+        }
+    }
+
+    /**
+     * Startup milestones of this run, all in microseconds since the launcher started.
+     *
+     * @return null when the app was not started by jr
+     */
+    public static synchronized Timings timings() {
+        long startEpochMicros = longProperty("jarrunner.start.epoch.micros");
+        long startNanoTime = longProperty("jarrunner.start.nanotime");
+        long startMicros = longProperty("jarrunner.start.micros");
+        long beforeJvmMicros = longProperty("jarrunner.beforejvm.micros");
+        if (startEpochMicros < 0 || startNanoTime < 0 || startMicros < 0 || beforeJvmMicros < 0) {
+            return null;
+        }
+
+        // The JVM's own start time only exists as epoch milliseconds
+        long jvmStartEpochMicros = ManagementFactory.getRuntimeMXBean().getStartTime() * 1000;
+        return new Timings(
+                beforeJvmMicros - startMicros,
+                jvmStartEpochMicros - startEpochMicros,
+                mainNanos < 0 ? -1 : (mainNanos - startNanoTime) / 1000,
+                readyNanos < 0 ? -1 : (readyNanos - startNanoTime) / 1000);
+    }
+
+    /**
+     * Launcher -> JVM created -> main -> ready, measured from the launcher's start.
+     * JVM creation has millisecond resolution, the other points microsecond resolution.
+     */
+    public static final class Timings {
+        /** Launcher start until it started java (launcher overhead). */
+        public final long javaStartedMicros;
+        /** Launcher start until the JVM was created. */
+        public final long jvmCreatedMicros;
+        /**
+         * Launcher start until {@link #mainStarted()}, -1 if it was not called or ran in
+         * the checkpointed JVM this one was restored from.
+         */
+        public final long mainMicros;
+        /**
+         * Launcher start until {@link #ready()}, or until the CRaC restore finished on a
+         * restored run. -1 if it was not called.
+         */
+        public final long readyMicros;
+
+        Timings(long javaStartedMicros, long jvmCreatedMicros, long mainMicros, long readyMicros) {
+            this.javaStartedMicros = javaStartedMicros;
+            this.jvmCreatedMicros = jvmCreatedMicros;
+            this.mainMicros = mainMicros;
+            this.readyMicros = readyMicros;
+        }
+
+        @Override
+        public String toString() {
+            StringBuilder sb = new StringBuilder();
+            sb.append(String.format("launcher %.2f ms, JVM create %.2f ms",
+                    javaStartedMicros / 1000.0, (jvmCreatedMicros - javaStartedMicros) / 1000.0));
+            long previous = jvmCreatedMicros;
+            if (mainMicros >= 0) {
+                sb.append(String.format(", to main %.2f ms", (mainMicros - previous) / 1000.0));
+                previous = mainMicros;
+            }
+            if (readyMicros >= 0) {
+                sb.append(String.format(", to ready %.2f ms", (readyMicros - previous) / 1000.0));
+                previous = readyMicros;
+            }
+            sb.append(String.format(" (total %.2f ms)", previous / 1000.0));
+            return sb.toString();
+        }
+    }
+
+    /**
+     * Working directory of this launch. In a warm JVM server (server=true) the JVM's own
+     * user.dir is wherever the server was started, so use this to resolve relative paths.
+     */
+    public static String workingDirectory() {
+        String directory = sessionDirectory.get();
+        return directory != null ? directory : System.getProperty("user.dir");
+    }
+
+    /**
+     * Environment of this launch; the counterpart of {@link System#getenv()} that also
+     * works in a warm JVM server (server=true).
+     */
+    public static Map<String, String> environment() {
+        Map<String, String> environment = sessionEnvironment.get();
+        return environment != null ? environment : System.getenv();
+    }
+
+    private static long longProperty(String name) {
+        String value = System.getProperty(name);
+        if (value == null) {
+            return -1;
+        }
+        try {
+            return Long.parseLong(value);
+        } catch (NumberFormatException e) {
+            return -1;
+        }
+    }
+
+    // Reflective, so JarRunner still compiles and runs on JDKs without jdk.crac. The
+    // checkpointed JVM exits here; the launcher restores it right away. Returns true in
+    // the restored JVM, false if no checkpoint was taken
+    private static boolean checkpoint() {
+        try {
+            Class.forName("jdk.crac.Core").getMethod("checkpointRestore").invoke(null);
+            return true;
+        } catch (ReflectiveOperationException e) {
+            Throwable cause = e.getCause() != null ? e.getCause() : e;
+            System.err.println("jarrunner: CRaC checkpoint failed: " + cause);
+            return false;
+        }
+    }
+
+    // Windows: named pipe served by the launcher. POSIX: inherited pipe descriptor,
+    // which the JDK can only open by number through the fd file system
+    private static String readyChannelPath() {
+        String pipe = System.getProperty("jarrunner.ready.pipe");
+        if (pipe != null) {
+            return pipe;
+        }
+        String fd = System.getProperty("jarrunner.ready.fd");
+        if (fd == null) {
+            return null;
+        }
+        return (new File("/proc/self/fd").isDirectory() ? "/proc/self/fd/" : "/dev/fd/") + fd;
+    }
+}
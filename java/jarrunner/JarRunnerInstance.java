@@ -0,0 +1,215 @@
+package jarrunner;
+
+import java.io.IOException;
+import java.net.StandardProtocolFamily;
+import java.net.UnixDomainSocketAddress;
+import java.nio.ByteBuffer;
+import java.nio.channels.ClosedChannelException;
+import java.nio.channels.FileChannel;
+import java.nio.channels.FileLock;
+import java.nio.channels.ServerSocketChannel;
+import java.nio.channels.SocketChannel;
+import java.nio.charset.Charset;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.Paths;
+import java.nio.file.StandardOpenOption;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+
+/**
+ * Single-instance support for single.instance=true in the .jrc file. The first
+ * instance listens for later launches; the launcher hands them over (arguments and
+ * working directory) without starting another JVM. Needs Java 16+; copy this file
+ * next to {@link JarRunner}.
+ *
+ * <pre>
+ * public static void main(String[] args) {
+ *     if (!JarRunnerInstance.claim(args, (moreArgs, dir) -&gt; openFiles(moreArgs, dir))) {
+ *         return;  // handed to the running instance
+ *     }
+ *     startApp(args);
+ * }
+ * </pre>
+ */
+public final class JarRunnerInstance {
+
+    /** Receives the launches that were forwarded to this instance. */
+    @FunctionalInterface
+    public interface Handler {
+        /**
+         * Called on a background thread, one launch at a time.
+         *
+         * @param args             command-line arguments of the new launch (without app.args)
+         * @param workingDirectory working directory of the new launch
+         */
+        void newInstance(String[] args, String workingDirectory);
+    }
+
+    // Frame types shared with the launcher (see launcher.c)
+    private static final byte FRAME_ARG = 'A';
+    private static final byte FRAME_CWD = 'D';
+    private static final byte FRAME_RUN = 'R';
+    private static final byte FRAME_EXIT = 'X';
+
+    // Longest frame accepted: one argument or the working directory (Linux caps an
+    // argument at 128 KB). Anything longer is not from the launcher and is dropped
+    private static final int MAX_FRAME = 1 << 20;
+
+    // How long a second JVM that lost the start race waits for the first to listen
+    private static final long CONNECT_TIMEOUT_MILLIS = 10_000;
+
+    private static final Charset ARG_CHARSET = Charset.forName(
+            System.getProperty("sun.jnu.encoding", Charset.defaultCharset().name()));
+
+    private static boolean claimed;
+    private static FileLock lock;  // Held for the life of the JVM
+
+    private JarRunnerInstance() {
+    }
+
+    /**
+     * Makes this JVM the app's single instance. Call it first thing in main.
+     *
+     * @return true if main should continue: this is the first instance, or the app was not
+     *         started with single.instance=true. false if the arguments were handed to an
+     *         instance that is already running and main should return
+     */
+    public static synchronized boolean claim(String[] args, Handler handler) {
+        String socketProperty = System.getProperty("jarrunner.instance.socket");
+        if (socketProperty == null || claimed) {
+            return true;
+        }
+        claimed = true;
+        Path socket = Paths.get(socketProperty);
+
+        try {
+            FileChannel lockChannel = FileChannel.open(Paths.get(socket + ".lock"),
+                    StandardOpenOption.CREATE, StandardOpenOption.WRITE);
+            lock = lockChannel.tryLock();
+            if (lock == null) {
+                // Two launches raced past the launcher's check: behave like the launcher would
+                lockChannel.close();
+                return !forward(socket, commandLineArgs(args));
+            }
+
+            // A socket file left by a crashed instance; the lock says nobody serves it
+            Files.deleteIfExists(socket);
+            ServerSocketChannel server = ServerSocketChannel.open(StandardProtocolFamily.UNIX);
+            server.bind(UnixDomainSocketAddress.of(socket));
+            Runtime.getRuntime().addShutdownHook(new Thread(() -> {
+                try {
+                    Files.deleteIfExists(socket);
+                } catch (IOException e) {
+                    // The next instance replaces it
+                }
+            }));
+
+            Thread listener = new Thread(() -> listen(server, handler), "jarrunner-instance");
+            listener.setDaemon(true);
+            listener.start();
+        } catch (IOException e) {
+            e.printStackTrace();  // Still usable, just not single-instance
+        }
+        return true;
+    }
+
+    private static void listen(ServerSocketChannel server, Handler handler) {
+        while (true) {
+            List<String> args = new ArrayList<>();
+            String directory = System.getProperty("user.dir");
+            try (SocketChannel channel = server.accept()) {
+                while (true) {
+                    ByteBuffer header = readFully(channel, 5);
+                    byte type = header.get();
+                    int size = header.getInt();
+                    if (size < 0 || size > MAX_FRAME) {
+                        throw new IOException("Invalid frame length " + size);
+                    }
+                    String value = new String(readFully(channel, size).array(), ARG_CHARSET);
+                    if (type == FRAME_ARG) {
+                        args.add(value);
+                    } else if (type == FRAME_CWD) {
+                        directory = value;
+                    } else if (type == FRAME_RUN) {
+                        break;
+                    }
+                }
+                // Acknowledge first so the launcher exits without waiting for the handler
+                writeFrame(channel, FRAME_EXIT, ByteBuffer.allocate(4).putInt(0).array());
+            } catch (ClosedChannelException e) {
+                return;
+            } catch (IOException e) {
+                continue;  // That launcher gave up; it starts the app itself
+            }
+
+            try {
+                handler.newInstance(args.toArray(new String[0]), directory);
+            } catch (RuntimeException e) {
+                e.printStackTrace();
+            }
+        }
+    }
+
+    // main's arguments without the leading .jrc app.args: the launcher passes how many came
+    // from the command line, which is all it forwards itself
+    private static String[] commandLineArgs(String[] args) {
+        int count = Integer.getInteger("jarrunner.instance.args", args.length);
+        if (count < 0 || count > args.length) {
+            return args;
+        }
+        return Arrays.copyOfRange(args, args.length - count, args.length);
+    }
+
+    // Hand the arguments to the instance holding the lock, which may still be starting
+    private static boolean forward(Path socket, String[] args) {
+        long deadline = System.currentTimeMillis() + CONNECT_TIMEOUT_MILLIS;
+        SocketChannel connection = null;
+        while (connection == null) {
+            try {
+                connection = SocketChannel.open(UnixDomainSocketAddress.of(socket));
+            } catch (IOException e) {
+                if (System.currentTimeMillis() >= deadline) {
+                    return false;
+                }
+                try {
+                    Thread.sleep(50);
+                } catch (InterruptedException interrupted) {
+                    Thread.currentThread().interrupt();
+                    return false;
+                }
+            }
+        }
+
+        try (SocketChannel channel = connection) {
+            for (String arg : args) {
+                writeFrame(channel, FRAME_ARG, arg.getBytes(ARG_CHARSET));
+            }
+            writeFrame(channel, FRAME_CWD, System.getProperty("user.dir").getBytes(ARG_CHARSET));
+            writeFrame(channel, FRAME_RUN, new byte[0]);
+            return readFully(channel, 5).get() == FRAME_EXIT;
+        } catch (IOException e) {
+            return false;
+        }
+    }
+
+    private static ByteBuffer readFully(SocketChannel channel, int size) throws IOException {
+        ByteBuffer buffer = ByteBuffer.allocate(size);
+        while (buffer.hasRemaining()) {
+            if (channel.read(buffer) < 0) {
+                throw new IOException("Connection closed");
+            }
+        }
+        buffer.flip();
+        return buffer;
+    }
+
+    private static void writeFrame(SocketChannel channel, byte type, byte[] payload) throws IOException {
+        ByteBuffer frame = ByteBuffer.allocate(5 + payload.length).put(type).putInt(payload.length).put(payload);
+        frame.flip();
+        while (frame.hasRemaining()) {
+            channel.write(frame);
+        }
+    }
+}
@@ -0,0 +1,583 @@
+package jarrunner;
+
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.InterruptedIOException;
+import java.io.OutputStream;
+import java.io.PrintStream;
+import java.lang.reflect.InvocationTargetException;
+import java.lang.reflect.Method;
+import java.lang.reflect.Modifier;
+import java.net.StandardProtocolFamily;
+import java.net.UnixDomainSocketAddress;
+import java.nio.ByteBuffer;
+import java.nio.channels.ClosedChannelException;
+import java.nio.channels.FileChannel;
+import java.nio.channels.FileLock;
+import java.nio.channels.ServerSocketChannel;
+import java.nio.channels.SocketChannel;
+import java.nio.charset.Charset;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.Paths;
+import java.nio.file.StandardOpenOption;
+import java.nio.file.attribute.FileTime;
+import java.util.ArrayDeque;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.jar.JarFile;
+import java.util.jar.Manifest;
+import java.util.logging.Handler;
+import java.util.logging.Level;
+import java.util.logging.LogRecord;
+import java.util.logging.Logger;
+
+/**
+ * Warm JVM host for server=true in the .jrc file. The launcher starts it once per
+ * JAR version and then sends each launch over a Unix domain socket; main() of the
+ * JAR's Main-Class runs in this JVM with stdin, stdout and stderr relayed to the
+ * launcher. Needs Java 16+ and must be on the app's class path (put it in the JAR
+ * next to {@link JarRunner}). Applications never call it directly.
+ *
+ * <p>Runs share the JVM: static state survives between runs, the working directory
+ * and environment of a run are only visible through {@link JarRunner#workingDirectory()}
+ * and {@link JarRunner#environment()}, and System.exit() ends the server (the run
+ * still reports its exit code on Java 21+).
+ *
+ * <p>With jarrunner.server.once (server=spare) the JVM is a spare instead: it takes
+ * a single launch, stops listening so the launcher can start the next spare, and
+ * runs main on its own main thread. That run ends like a normal java launch, with
+ * the last non-daemon thread or System.exit().
+ */
+public final class JarRunnerServer {
+
+    /** Exit code when another server already owns the socket; the launcher keeps waiting. */
+    static final int EXIT_LOCKED = 75;
+
+    // Frame types: 1 type byte, 4-byte big-endian payload length, payload (see launcher.c)
+    private static final byte FRAME_ARG = 'A';
+    private static final byte FRAME_ENV = 'E';
+    private static final byte FRAME_CWD = 'D';
+    private static final byte FRAME_RUN = 'R';
+    private static final byte FRAME_STDIN = '0';
+    private static final byte FRAME_STDIN_EOF = '.';
+    private static final byte FRAME_STARTED = 'S';
+    private static final byte FRAME_STDOUT = '1';
+    private static final byte FRAME_STDERR = '2';
+    private static final byte FRAME_EXIT = 'X';
+
+    // The launcher reads frames into a buffer of this size, and sends stdin in chunks of it
+    private static final int MAX_FRAME = 65536;
+
+    // Longest request frame accepted: one argument or environment entry (Linux caps
+    // those at 128 KB). Anything longer is not from the launcher and ends the session
+    private static final int MAX_REQUEST_FRAME = 1 << 20;
+
+    // Decodes arguments the way the java launcher does
+    private static final Charset ARG_CHARSET = Charset.forName(
+            System.getProperty("sun.jnu.encoding", Charset.defaultCharset().name()));
+
+    private static final InheritableThreadLocal<Session> CURRENT = new InheritableThreadLocal<>();
+
+    private static final Object lifecycle = new Object();
+    private static int activeSessions;
+    private static long lastActivityNanos = System.nanoTime();
+
+    // server=spare: exit code the shutdown hook reports (1 until main returns, as
+    // System.exit() before Java 21 is not observable)
+    private static boolean once;
+    private static volatile int onceExitCode = 1;
+
+    // Server's own output (<socket>.log), System.err is per run once the server listens
+    private static PrintStream serverLog = System.err;
+
+    // Held here: the logging framework only keeps weak references to loggers
+    private static Logger runtimeLogger;
+
+    private JarRunnerServer() {
+    }
+
+    public static void main(String[] args) throws Exception {
+        Path socket = Paths.get(requiredProperty("jarrunner.server.socket"));
+        Path jar = Paths.get(requiredProperty("jarrunner.server.jar"));
+        long idleNanos = Long.getLong("jarrunner.server.idle", 600) * 1_000_000_000L;
+        once = Boolean.getBoolean("jarrunner.server.once");
+
+        // One server per socket: a launcher that lost the start race exits quietly
+        Path lockPath = Paths.get(socket + ".lock");
+        FileChannel lockChannel = FileChannel.open(lockPath, StandardOpenOption.CREATE, StandardOpenOption.WRITE);
+        FileLock lock = lockChannel.tryLock();
+        if (lock == null) {
+            System.exit(EXIT_LOCKED);
+        }
+
+        long jarSize = Files.size(jar);
+        FileTime jarModified = Files.getLastModifiedTime(jar);
+        Method main = findMain(jar);
+
+        // A socket file left by a crashed server; the lock says nobody serves it
+        Files.deleteIfExists(socket);
+        ServerSocketChannel server = ServerSocketChannel.open(StandardProtocolFamily.UNIX);
+        server.bind(UnixDomainSocketAddress.of(socket));
+
+        System.setOut(new PrintStream(new SessionOutput(FRAME_STDOUT, System.out), true));
+        System.setErr(new PrintStream(new SessionOutput(FRAME_STDERR, System.err), true));
+        System.setIn(new SessionInput(System.in));
+        captureExit();
+
+        Thread watchdog = new Thread(() -> watch(server, socket, lockPath, jar, jarSize, jarModified, idleNanos),
+                "jarrunner-server-watchdog");
+        watchdog.setDaemon(true);
+        watchdog.start();
+
+        if (once) {
+            serveOnce(server, socket, lock, main);
+            return;
+        }
+        while (true) {
+            SocketChannel channel;
+            try {
+                channel = server.accept();
+            } catch (ClosedChannelException e) {
+                return;  // Closed by the watchdog, which ends the JVM
+            }
+            synchronized (lifecycle) {
+                activeSessions++;
+                lastActivityNanos = System.nanoTime();
+            }
+            // Named like the thread the java launcher runs main on
+            new Thread(() -> serve(new Session(channel), main), "main").start();
+        }
+    }
+
+    private static String requiredProperty(String name) {
+        String value = System.getProperty(name);
+        if (value == null) {
+            throw new IllegalStateException("JarRunnerServer is started by the launcher (server=true), " + name + " is not set");
+        }
+        return value;
+    }
+
+    private static Method findMain(Path jar) throws IOException, ReflectiveOperationException {
+        String mainClass;
+        try (JarFile jarFile = new JarFile(jar.toFile())) {
+            Manifest manifest = jarFile.getManifest();
+            mainClass = manifest != null ? manifest.getMainAttributes().getValue("Main-Class") : null;
+        }
+        if (mainClass == null) {
+            throw new IllegalStateException("No Main-Class in the manifest of " + jar);
+        }
+        Class<?> type = Class.forName(mainClass.trim(), false, ClassLoader.getSystemClassLoader());
+        Method main = type.getMethod("main", String[].class);
+        if (!Modifier.isStatic(main.getModifiers())) {
+            throw new IllegalStateException(mainClass + ".main is not static");
+        }
+        main.setAccessible(true);  // Main-Class itself does not have to be public
+        return main;
+    }
+
+    // One launch on the shared server: run it, report the exit code when main ends
+    private static void serve(Session session, Method main) {
+        try {
+            int exitCode = runSession(session, main);
+            if (exitCode >= 0) {
+                session.exit(exitCode);
+            }
+        } finally {
+            session.close();
+            synchronized (lifecycle) {
+                activeSessions--;
+                lastActivityNanos = System.nanoTime();
+                lifecycle.notifyAll();
+            }
+        }
+    }
+
+    // server=spare: the first launch claims this JVM for good
+    private static void serveOnce(ServerSocketChannel server, Path socket, FileLock lock, Method main)
+            throws IOException {
+        SocketChannel channel;
+        try {
+            channel = server.accept();
+        } catch (ClosedChannelException e) {
+            return;  // Idle or JAR changed before anyone claimed it
+        }
+        synchronized (lifecycle) {
+            activeSessions++;  // Keeps the watchdog from ending the run
+        }
+
+        // Make room for the next spare before running anything
+        server.close();
+        Files.deleteIfExists(socket);
+        lock.release();
+        lock.channel().close();
+
+        Session session = new Session(channel);
+        Runtime.getRuntime().addShutdownHook(new Thread(() -> session.exit(onceExitCode)));
+        int exitCode = runSession(session, main);
+        onceExitCode = exitCode < 0 ? 0 : exitCode;
+    }
+
+    // Read the request and run main on the calling thread; -1 if the launcher went
+    // away before sending a complete request
+    private static int runSession(Session session, Method main) {
+        try {
+            if (!session.readRequest()) {
+                return -1;
+            }
+            CURRENT.set(session);
+            JarRunner.sessionDirectory.set(session.directory);
+            JarRunner.sessionEnvironment.set(Collections.unmodifiableMap(session.environment));
+            session.started(Thread.currentThread());
+
+            int exitCode = 0;
+            try {
+                main.invoke(null, (Object) session.args.toArray(new String[0]));
+            } catch (InvocationTargetException e) {
+                System.err.print("Exception in thread \"main\" ");
+                e.getCause().printStackTrace();
+                exitCode = 1;
+            }
+            System.out.flush();
+            System.err.flush();
+            return exitCode;
+        } catch (IOException | IllegalAccessException e) {
+            e.printStackTrace(serverLog);
+            return 1;
+        }
+    }
+
+    // Java 21+ logs Runtime.exit() at DEBUG on the exiting thread: pass the status on
+    // before the JVM goes down
+    private static void captureExit() {
+        runtimeLogger = Logger.getLogger("java.lang.Runtime");
+        runtimeLogger.setLevel(Level.FINE);
+        runtimeLogger.setUseParentHandlers(false);
+        runtimeLogger.addHandler(new Handler() {
+            @Override
+            public void publish(LogRecord record) {
+                Session session = CURRENT.get();
+                Throwable thrown = record.getThrown();
+                String message = thrown != null ? thrown.getMessage() : null;
+                if (session == null || message == null || !message.startsWith("Runtime.exit(") || !message.endsWith(")")) {
+                    return;
+                }
+                try {
+                    int status = Integer.parseInt(message.substring(13, message.length() - 1));
+                    System.out.flush();
+                    System.err.flush();
+                    session.exit(status);
+                } catch (NumberFormatException ignored) {
+                    // Not the message this handler knows
+                }
+            }
+
+            @Override
+            public void flush() {
+            }
+
+            @Override
+            public void close() {
+            }
+        });
+    }
+
+    // Ends the server after the idle timeout or when the JAR changes; later launches
+    // of a changed JAR use a different socket and start a new server
+    private static void watch(ServerSocketChannel server, Path socket, Path lockPath, Path jar,
+                              long jarSize, FileTime jarModified, long idleNanos) {
+        try {
+            while (true) {
+                Thread.sleep(1000);
+                boolean jarChanged;
+                try {
+                    jarChanged = Files.size(jar) != jarSize || !Files.getLastModifiedTime(jar).equals(jarModified);
+                } catch (IOException e) {
+                    jarChanged = true;
+                }
+                boolean idle;
+                synchronized (lifecycle) {
+                    idle = activeSessions == 0 && System.nanoTime() - lastActivityNanos > idleNanos;
+                }
+                if (jarChanged || idle) {
+                    break;
+                }
+            }
+
+            server.close();
+            Files.deleteIfExists(socket);
+            synchronized (lifecycle) {
+                while (activeSessions > 0) {
+                    lifecycle.wait();
+                }
+            }
+            Files.deleteIfExists(lockPath);
+        } catch (InterruptedException | IOException e) {
+            // Shutting down either way
+        }
+        System.exit(0);
+    }
+
+    // Connection to one launcher; output may come from any thread of the run
+    private static final class Session {
+        private final SocketChannel channel;
+        final List<String> args = new ArrayList<>();
+        final Map<String, String> environment = new HashMap<>();
+        String directory;
+
+        private final ArrayDeque<byte[]> input = new ArrayDeque<>();
+        private byte[] inputChunk;
+        private int inputPos;
+        private boolean inputClosed;
+        private boolean exited;
+
+        Session(SocketChannel channel) {
+            this.channel = channel;
+        }
+
+        boolean readRequest() throws IOException {
+            while (true) {
+                ByteBuffer header = readFully(5);
+                if (header == null) {
+                    return false;
+                }
+                byte type = header.get();
+                ByteBuffer payload = readPayload(header.getInt(), MAX_REQUEST_FRAME);
+                if (payload == null) {
+                    return false;
+                }
+                String value = new String(payload.array(), ARG_CHARSET);
+                if (type == FRAME_ARG) {
+                    args.add(value);
+                } else if (type == FRAME_ENV) {
+                    int eq = value.indexOf('=');
+                    if (eq > 0) {
+                        environment.put(value.substring(0, eq), value.substring(eq + 1));
+                    }
+                } else if (type == FRAME_CWD) {
+                    directory = value;
+                } else if (type == FRAME_RUN) {
+                    return true;
+                }
+            }
+        }
+
+        // Payload of a frame; null if the connection closed or the length cannot be valid,
+        // so a broken client cannot make the shared JVM allocate for it
+        private ByteBuffer readPayload(int size, int maxSize) throws IOException {
+            if (size < 0 || size > maxSize) {
+                return null;
+            }
+            return readFully(size);
+        }
+
+        private ByteBuffer readFully(int size) throws IOException {
+            ByteBuffer buffer = ByteBuffer.allocate(size);
+            while (buffer.hasRemaining()) {
+                if (channel.read(buffer) < 0) {
+                    return null;
+                }
+            }
+            buffer.flip();
+            return buffer;
+        }
+
+        // Tell the launcher main is starting and relay its stdin from now on
+        void started(Thread mainThread) throws IOException {
+            send(FRAME_STARTED, new byte[0], 0, 0);
+            Thread pump = new Thread(() -> pumpInput(mainThread), "jarrunner-stdin");
+            pump.setDaemon(true);
+            pump.start();
+        }
+
+        private void pumpInput(Thread mainThread) {
+            try {
+                while (true) {
+                    ByteBuffer header = readFully(5);
+                    if (header == null) {
+                        break;
+                    }
+                    byte type = header.get();
+                    ByteBuffer payload = readPayload(header.getInt(), MAX_FRAME);
+                    if (payload == null) {
+                        break;
+                    }
+                    if (type == FRAME_STDIN) {
+                        synchronized (input) {
+                            input.add(payload.array());
+                            input.notifyAll();
+                        }
+                    } else if (type == FRAME_STDIN_EOF) {
+                        closeInput();
+                    }
+                }
+            } catch (IOException e) {
+                // Connection closed
+            }
+            closeInput();
+            // The launcher is gone (Ctrl+C): nobody waits for this run any more
+            boolean running;
+            synchronized (this) {
+                running = !exited;
+            }
+            if (running && once) {
+                System.exit(1);  // The spare's JVM belongs to the run, as java would be killed
+            } else if (running) {
+                mainThread.interrupt();
+            }
+        }
+
+        private void closeInput() {
+            synchronized (input) {
+                inputClosed = true;
+                input.notifyAll();
+            }
+        }
+
+        int read(byte[] b, int off, int len) throws IOException {
+            synchronized (input) {
+                while (inputChunk == null || inputPos == inputChunk.length) {
+                    inputChunk = input.poll();
+                    inputPos = 0;
+                    if (inputChunk != null) {
+                        continue;
+                    }
+                    if (inputClosed) {
+                        return -1;
+                    }
+                    try {
+                        input.wait();
+                    } catch (InterruptedException e) {
+                        Thread.currentThread().interrupt();
+                        throw new InterruptedIOException();
+                    }
+                }
+                int count = Math.min(len, inputChunk.length - inputPos);
+                System.arraycopy(inputChunk, inputPos, b, off, count);
+                inputPos += count;
+                return count;
+            }
+        }
+
+        int available() {
+            synchronized (input) {
+                return inputChunk != null ? inputChunk.length - inputPos : 0;
+            }
+        }
+
+        synchronized void send(byte type, byte[] b, int off, int len) throws IOException {
+            if (exited) {
+                return;
+            }
+            do {
+                int chunk = Math.min(len, MAX_FRAME);
+                ByteBuffer header = ByteBuffer.allocate(5).put(type).putInt(chunk);
+                header.flip();
+                ByteBuffer data = ByteBuffer.wrap(b, off, chunk);
+                while (header.hasRemaining() || data.hasRemaining()) {
+                    channel.write(new ByteBuffer[] {header, data});
+                }
+                off += chunk;
+                len -= chunk;
+            } while (len > 0);
+        }
+
+        synchronized void exit(int status) {
+            if (exited) {
+                return;
+            }
+            try {
+                byte[] code = ByteBuffer.allocate(4).putInt(status).array();
+                send(FRAME_EXIT, code, 0, code.length);
+            } catch (IOException e) {
+                // Launcher already gone
+            }
+            exited = true;
+        }
+
+        void close() {
+            synchronized (this) {
+                exited = true;
+            }
+            try {
+                channel.close();
+            } catch (IOException e) {
+                // Nothing left to do
+            }
+        }
+    }
+
+    // System.out / System.err: the current run's launcher, or the server log outside a run
+    private static final class SessionOutput extends OutputStream {
+        private final byte type;
+        private final OutputStream serverLog;
+
+        SessionOutput(byte type, OutputStream serverLog) {
+            this.type = type;
+            this.serverLog = serverLog;
+        }
+
+        @Override
+        public void write(int b) throws IOException {
+            write(new byte[] {(byte) b}, 0, 1);
+        }
+
+        @Override
+        public void write(byte[] b, int off, int len) throws IOException {
+            Session session = CURRENT.get();
+            if (session == null) {
+                serverLog.write(b, off, len);
+                return;
+            }
+            try {
+                session.send(type, b, off, len);
+            } catch (IOException e) {
+                // Launcher gone; the run's output has nowhere to go
+            }
+        }
+
+        @Override
+        public void flush() throws IOException {
+            if (CURRENT.get() == null) {
+                serverLog.flush();
+            }
+        }
+    }
+
+    // System.in: the current run's forwarded stdin
+    private static final class SessionInput extends InputStream {
+        private final InputStream serverInput;
+
+        SessionInput(InputStream serverInput) {
+            this.serverInput = serverInput;
+        }
+
+        @Override
+        public int read() throws IOException {
+            byte[] b = new byte[1];
+            int count = read(b, 0, 1);
+            return count < 0 ? -1 : b[0] & 0xff;
+        }
+
+        @Override
+        public int read(byte[] b, int off, int len) throws IOException {
+            Session session = CURRENT.get();
+            if (session == null) {
+                return serverInput.read(b, off, len);
+            }
+            if (len == 0) {
+                return 0;
+            }
+            return session.read(b, off, len);
+        }
+
+        @Override
+        public int available() throws IOException {
+            Session session = CURRENT.get();
+            return session == null ? serverInput.available() : session.available();
+        }
+    }
+}
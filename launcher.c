@@ -1,4 +1,28 @@
+#ifdef _WIN32
+#include <winsock2.h>
 #include <windows.h>
+#include <afunix.h>
+#include <psapi.h>
+#else
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
+#include <limits.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -6,28 +30,278 @@
 #include <sys/stat.h>
 #include <time.h>
 
+// In-process JVM hosting needs jni.h from a JDK at build time (see build scripts)
+#ifdef JR_JNI_HOSTING
+#include <jni.h>
+#ifndef _WIN32
+#include <dlfcn.h>
+#include <pthread.h>
+#endif
+#endif
+
 #define MAX_PATH_LEN 32768
-#define MAX_CMD_LEN 32768
 #define MAX_CONFIG_LINE 4096
+#define ARENA_BLOCK_SIZE 4096
+
+// Launch modes (launch.mode in .jrc)
+#define LAUNCH_MODE_SPAWN 0        // Start java as a child process (default)
+#define LAUNCH_MODE_EXEC 1         // Replace the launcher process with java (POSIX only)
+#define LAUNCH_MODE_JNI 2          // Host the JVM in-process via JNI_CreateJavaVM
+
+// Warm JVM modes (server in .jrc)
+#define SERVER_MODE_OFF 0
+#define SERVER_MODE_SHARED 1       // server=true: one resident JVM runs every launch
+#define SERVER_MODE_SPARE 2        // server=spare: a pre-started JVM per launch, replaced after it
+
+// Platform glue: the launcher logic below is written against the Win32 names,
+// POSIX builds map them onto their libc equivalents
+#ifdef _WIN32
+    #define PATH_SEP "\\"
+    #define PATH_LIST_SEP ";"
+    #define EXE_SUFFIX ".exe"
+    #define JAVA_EXE "java.exe"
+    #define JAVAW_EXE "javaw.exe"
+    #define JAVA_HOME_EXAMPLE "C:\\path\\to\\jdk"
+    #define MSG_NOSIGNAL 0
+#else
+    typedef int BOOL;
+    #define TRUE 1
+    #define FALSE 0
+    #define MAX_PATH 4096
+    #define MB_ICONERROR 0x10
+    #define MB_ICONINFORMATION 0x40
+    #define _stricmp strcasecmp
+    #define _strnicmp strncasecmp
+    #define _strdup strdup
+    #define _stat64 stat
+    #define PATH_SEP "/"
+    #define PATH_LIST_SEP ":"
+    #define EXE_SUFFIX ""
+    #define JAVA_EXE "java"
+    #define JAVAW_EXE "java"
+    #define JAVA_HOME_EXAMPLE "/path/to/jdk"
+    typedef int SOCKET;
+    #define INVALID_SOCKET (-1)
+    #define closesocket close
+
+    // pidfd_open(2) and waitid(P_PIDFD) are Linux 5.3+; older headers lack the constants
+    #ifndef P_PIDFD
+        #define P_PIDFD 3
+    #endif
+
+    extern char** environ;
+#endif
+
+#define MAX_VERSIONED_ARGS 16
 
-// Configuration structure
+// vm.args line that only applies to some Java feature releases (vm.args.21=, vm.args.25+=)
 typedef struct {
-    char vmArgs[MAX_CMD_LEN];      // VM arguments (before -jar)
-    char javaArgs[MAX_CMD_LEN];    // Java arguments (-jar, -cp, main class, etc.)
-    char appArgs[MAX_CMD_LEN];     // Application arguments (after jar/class)
+    int minMajor;                  // Lowest matching feature release
+    int maxMajor;                  // Highest matching feature release (0 = no upper bound)
+    const char* args;
+} VersionedArgs;
+
+// Configuration structure (string values point into the arena copy of the .jrc file)
+typedef struct {
+    const char* vmArgs;            // VM arguments (before -jar)
+    const char* javaArgs;          // Java arguments (-jar, -cp, main class, etc.)
+    const char* appArgs;           // Application arguments (after jar/class)
     char logFile[MAX_PATH];        // Log file path
+    char traceFile[MAX_PATH];      // Trace-event JSON output (trace.file)
+    char metricsDir[MAX_PATH];     // Prometheus textfile directory (metrics.dir)
     char logLevel[32];             // Log level: info, warning, error, none
+    int logFormat;                 // LOG_FORMAT_* (log.format=text|json)
     int logOverwrite;              // Overwrite log file (1) or append (0)
     int enableAOT;                 // Enable AOT cache (1=yes, 0=no, -1=not specified)
+    int aotBackground;             // Create a missing cache in a background run (aot.background)
+    int aotContentKey;             // Name caches after the JAR's content (aot.key=content)
+    const char* aotTrainArgs;      // Training workload arguments (aot.train.args, implies aot.background)
+    const char* aotTrainEnv;       // NAME=value pairs for the training run (aot.train.env)
+    int aotTrainTimeout;           // Seconds before the workload is stopped (aot.train.timeout)
+    int launchMode;                // LAUNCH_MODE_* (-1=not specified)
+    int planCache;                 // Cache the resolved launch plan (1=yes, 0=no)
+    int journal;                   // Record launches for jr --stats (1=yes, 0=no)
+    int readySignal;               // Hand java a readiness channel (ready.signal)
+    int readyNotify;               // Forward readiness to systemd (ready.notify)
+    int serverMode;                // SERVER_MODE_* (server=true|spare)
+    int serverIdle;                // Seconds before an unused server exits (server.idle)
+    int singleInstance;            // Forward launches to the running app (single.instance)
+    int crac;                      // Checkpoint/restore the app with CRaC (crac=true)
+    VersionedArgs versionedVmArgs[MAX_VERSIONED_ARGS]; // vm.args.<range> in file order
+    int versionedVmArgsCount;
 } LauncherConfig;
 
-// Global log file handle
+// Growable argument vector in the arena, kept NULL-terminated so items can be passed as argv
+typedef struct {
+    char** items;
+    int count;
+    int capacity;
+} ArgList;
+
+// Launcher options from the front of the command line
+typedef struct {
+    const char* javaHome;          // --java-home=PATH / --java-home PATH (NULL = search PATH)
+    int enableAOT;                 // --enable-aot / --disable-aot (-1=not specified)
+    int launchMode;                // --exec (-1=not specified)
+    int noPlanCache;               // --no-plan-cache
+    const char* traceFile;         // --trace=FILE (NULL = trace.file from .jrc)
+    int stats;                     // --stats [app]: print launch statistics and exit
+    const char* statsApp;
+    int createConfig;              // --create-config [jar-file]
+    const char* createConfigJar;
+    int aotTrain;                  // --aot-train ...: internal, supervises a background AOT training
+    char** appArgs;                // Remaining arguments (JAR and/or application arguments)
+    int appArgCount;
+} LauncherOptions;
+
+// AOT decision of a launch
+#define AOT_MODE_NONE 0
+#define AOT_MODE_USE 1             // -XX:AOTCache / SharedArchiveFile (cache exists)
+#define AOT_MODE_CREATE 2          // -XX:AOTCacheOutput / ArchiveClassesAtExit (first run of this JAR version)
+
+// CRaC decision of a launch (crac=true); replaces the AOT cache when active
+#define CRAC_MODE_NONE 0
+#define CRAC_MODE_RESTORE 1        // -XX:CRaCRestoreFrom (checkpoint exists)
+#define CRAC_MODE_CHECKPOINT 2     // -XX:CRaCCheckpointTo, taken at JarRunner.ready()
+
+// Fully resolved launch: the result of .jrc parsing, Java lookup and the AOT
+// decision. Built by resolveLaunchPlan() or loaded from the launch-plan cache
+typedef struct {
+    char javaPath[MAX_PATH];       // java/javaw executable
+    char jarPath[MAX_PATH];        // JAR the AOT cache belongs to (empty if none)
+    char aotPath[MAX_PATH];        // AOT cache or CDS archive file (empty for AOT_MODE_NONE
+                                   // unless aotTrain)
+    char cracPath[MAX_PATH];       // CRaC checkpoint directory (empty for CRAC_MODE_NONE)
+    int cracMode;                  // CRAC_MODE_*
+    int aotMode;                   // AOT_MODE_*
+    int aotTrain;                  // Cache missing: trainArgs create it in the background
+    int aotContentKey;             // Cache names come from the JAR's content hash
+    int launchMode;                // LAUNCH_MODE_*
+    ArgList javaArgs;              // Java arguments after the timing properties
+    ArgList trainArgs;             // Java arguments of the background training run
+    ArgList createArgs;            // Java arguments of its -XX:AOTMode=create step (empty = one step)
+    ArgList trainEnv;              // Extra NAME=value environment of the training run
+    int trainTimeout;              // Seconds before the training workload is stopped (0 = never)
+    char logFile[MAX_PATH];        // Log file path (empty = no logging)
+    int logOverwrite;              // Overwrite log file (1) or append (0)
+    int logLevel;                  // LOG_LEVEL_*
+    int logFormat;                 // LOG_FORMAT_*
+    char traceFile[MAX_PATH];      // trace.file from .jrc (empty = no trace)
+    char metricsDir[MAX_PATH];     // metrics.dir from .jrc (empty = no .prom file)
+    int journal;                   // Append a launch journal record
+    int readySignal;               // Pass a readiness channel to java
+    int readyNotify;               // Send sd_notify READY=1 when java is ready
+    int serverMode;                // SERVER_MODE_*
+    int serverIdle;                // Idle timeout passed to a newly started server
+    int singleInstance;            // Forward to the running instance, else pass it the socket
+    int jdkMajor;                  // Feature release of the selected Java (0 = unknown)
+    int aotCleanups;               // Stale AOT files and checkpoints removed while resolving (not saved)
+} LaunchPlan;
+
+// Resource usage of a java child the launcher waited for
+typedef struct {
+    int valid;
+    long long wallMicros;          // Spawn until exit
+    long long userMicros;          // User-mode CPU time
+    long long systemMicros;        // Kernel-mode CPU time
+    long long peakRssKB;           // Peak resident set (peak working set on Windows)
+    long long majorFaults;         // Faults that had to read from disk (-1 = not reported, Windows)
+    long long minorFaults;         // Faults served from memory (all page faults on Windows)
+} ChildUsage;
+
+// JVM capabilities learned by the JDK probe
+#define JDK_FEATURE_CDS_DYNAMIC 0x01   // -XX:ArchiveClassesAtExit / SharedArchiveFile (JDK 13+)
+#define JDK_FEATURE_CDS_AUTO 0x02      // -XX:+AutoCreateSharedArchive (JDK 19+)
+#define JDK_FEATURE_AOT_CACHE 0x04     // -XX:AOTCache (JDK 24+)
+#define JDK_FEATURE_AOT_OUTPUT 0x08    // -XX:AOTCacheOutput one-step cache creation (JDK 25+)
+#define JDK_FEATURE_CRAC 0x10          // -XX:CRaCCheckpointTo / CRaCRestoreFrom (CRaC builds, Linux)
+
+// What the launcher knows about a Java installation
+typedef struct {
+    int major;                     // Feature release (8, 17, 21, 25, ...), 0 if unknown
+    unsigned int features;         // JDK_FEATURE_* flags
+    char version[64];              // Full version string, e.g. 21.0.2
+    char vendor[64];               // IMPLEMENTOR from the release file
+} JdkInfo;
+
+// Log levels (log.level) and formats (log.format)
+#define LOG_LEVEL_INFO 0
+#define LOG_LEVEL_WARNING 1
+#define LOG_LEVEL_ERROR 2
+#define LOG_LEVEL_NONE 3
+
+#define LOG_FORMAT_TEXT 0          // [LEVEL] message
+#define LOG_FORMAT_JSON 1          // One JSON object per line
+
+#define LOG_BUFFER_SIZE 8192
+
+// Global log state: records are buffered until flushLog()
 static FILE* g_logFile = NULL;
 static int g_logEnabled = 0;
+static int g_logLevel = LOG_LEVEL_INFO;
+static int g_logFormat = LOG_FORMAT_TEXT;
+static int g_logOverwrite = 0;
+static char g_logPath[MAX_PATH];
+static time_t g_logStartTime;
+static char* g_logBuffer = NULL;
+static size_t g_logBufferUsed = 0;
+static size_t g_logBufferSize = 0;
+
+// Bump arena for config values and command assembly, released before waiting on Java
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t size;
+    size_t used;
+    size_t reserved;               // Keeps the data that follows 16-byte aligned
+} ArenaBlock;
+
+static ArenaBlock* g_arena = NULL;
+static size_t g_arenaBytes = 0;
 
 // Global timing variables
+#ifdef _WIN32
 static LARGE_INTEGER g_perfFreq;
 static LARGE_INTEGER g_startTime;
+#else
+static struct timespec g_startTime;
+#endif
+static long long g_startEpochMicros;  // Wall clock at timer start, microseconds since 1970
+static long long g_startNanoTime;     // Monotonic clock at timer start, in System.nanoTime() units
+
+// Launcher phases, timed for -Djarrunner.phase.<name>.micros and the log
+#define PHASE_EXE_NAME 0           // Own path, base name and .jrc path
+#define PHASE_CONSOLE 1            // Console / GUI detection
+#define PHASE_PLAN 2               // Launch-plan lookup and save
+#define PHASE_CONFIG 3             // .jrc parse
+#define PHASE_LOG_INIT 4           // Opening the log file
+#define PHASE_JAVA_LOOKUP 5        // --java-home check or PATH scan
+#define PHASE_JDK_PROBE 6          // JDK version probe
+#define PHASE_AOT_NAME 7           // AOT cache name and stat
+#define PHASE_AOT_CLEANUP 8        // Removal of outdated AOT files
+#define PHASE_COMMAND 9            // Java argument vector assembly
+#define PHASE_SPAWN 10             // Process creation (log only, java is already running)
+#define PHASE_SERVER 11            // Warm JVM server connect or start (log only, server=true)
+#define PHASE_COUNT 12
+
+static const char* PHASE_NAMES[PHASE_COUNT] = {
+    "exename", "console", "plan", "config", "loginit", "javalookup",
+    "jdkprobe", "aotname", "aotcleanup", "command", "spawn", "server"
+};
+
+static long long g_phaseMicros[PHASE_COUNT];
+static unsigned int g_phasesRun = 0;       // Bit per phase that was executed
+
+// Individual phase runs on the launcher timeline, for --trace
+#define MAX_PHASE_EVENTS 32
+
+typedef struct {
+    int phase;
+    long long startMicros;
+    long long durationMicros;
+} PhaseEvent;
+
+static PhaseEvent g_phaseEvents[MAX_PHASE_EVENTS];
+static int g_phaseEventCount = 0;
 
 // Base52 encoding (alphanumeric, case-sensitive without confusing chars)
 // Using: 0-9, A-Z (except I, O), a-z (except l, o)
@@ -35,7 +309,9 @@ static const char BASE52_CHARS[] = "0123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghij
 
 // Hide console window as early as possible to prevent flash in GUI mode
 // This runs before main() via compiler-specific mechanisms
-#ifdef _MSC_VER
+#ifndef _WIN32
+    // POSIX: no console window to hide
+#elif defined(_MSC_VER)
     // MSVC: Use #pragma to run at startup
     #pragma section(".CRT$XCU", read)
     static void hideConsoleEarly(void) {
@@ -61,7 +337,7 @@ static const char BASE52_CHARS[] = "0123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghij
  * Features:
  * - Auto-detects console vs GUI mode (java.exe vs javaw.exe)
  * - Config file support (.jrc) for renamed executables
- * - AOT cache support (JDK 25+) with auto-management
+ * - AOT cache support (JDK 25+) with auto-management, dynamic CDS archives on JDK 13-24
  * - Flexible configuration (VM args, Java args, App args)
  * - Optional debug logging
  * - Performance timing measurements
@@ -69,63 +345,226 @@ static const char BASE52_CHARS[] = "0123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghij
 
 // Initialize high-resolution timer
 void initTimer() {
+#ifdef _WIN32
     QueryPerformanceFrequency(&g_perfFreq);
     QueryPerformanceCounter(&g_startTime);
+
+    FILETIME wallClock;
+    GetSystemTimePreciseAsFileTime(&wallClock);
+    ULARGE_INTEGER ticks;
+    ticks.LowPart = wallClock.dwLowDateTime;
+    ticks.HighPart = wallClock.dwHighDateTime;
+    g_startEpochMicros = (long long)(ticks.QuadPart / 10) - 11644473600000000LL;  // 1601 -> 1970
+
+    // HotSpot's System.nanoTime() on Windows is the performance counter scaled the same way
+    g_startNanoTime = (long long)((double)g_startTime.QuadPart / (double)g_perfFreq.QuadPart * 1e9);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &g_startTime);
+
+    struct timespec wallClock;
+    clock_gettime(CLOCK_REALTIME, &wallClock);
+    g_startEpochMicros = wallClock.tv_sec * 1000000LL + wallClock.tv_nsec / 1000;
+
+    // System.nanoTime() on Linux reads CLOCK_MONOTONIC as well
+    g_startNanoTime = g_startTime.tv_sec * 1000000000LL + g_startTime.tv_nsec;
+#endif
 }
 
 // Get elapsed microseconds since start
 long long getElapsedMicros() {
+#ifdef _WIN32
     LARGE_INTEGER now;
     QueryPerformanceCounter(&now);
     return ((now.QuadPart - g_startTime.QuadPart) * 1000000LL) / g_perfFreq.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - g_startTime.tv_sec) * 1000000LL
+         + (now.tv_nsec - g_startTime.tv_nsec) / 1000;
+#endif
+}
+
+// Add the time since startMicros to a phase (phases may run more than once)
+void recordPhase(int phase, long long startMicros) {
+    long long duration = getElapsedMicros() - startMicros;
+    g_phaseMicros[phase] += duration;
+    g_phasesRun |= 1u << phase;
+
+    if (g_phaseEventCount < MAX_PHASE_EVENTS) {
+        PhaseEvent* event = &g_phaseEvents[g_phaseEventCount++];
+        event->phase = phase;
+        event->startMicros = startMicros;
+        event->durationMicros = duration;
+    }
+}
+
+// Launcher timeline point where java started: end of the spawn phase, or
+// fallbackMicros when there was no spawn (exec, jni)
+long long getJavaStartMicros(long long fallbackMicros) {
+    long long javaStart = fallbackMicros;
+    for (int i = 0; i < g_phaseEventCount; i++) {
+        if (g_phaseEvents[i].phase == PHASE_SPAWN) {
+            javaStart = g_phaseEvents[i].startMicros + g_phaseEvents[i].durationMicros;
+        }
+    }
+    return javaStart;
 }
 
 // Logging functions
-void initLog(const char* logPath, int overwrite) {
-    if (!logPath || !*logPath) {
+// Records are filtered by level before formatting and collected in memory; the
+// file is opened and written in one go by flushLog() (after the spawn, before
+// exec/JNI hosting, and at closeLog), so logging adds no disk I/O before java starts
+
+// Map a level name to LOG_LEVEL_* ("INFO", "warning", ...); unknown names mean info
+int parseLogLevel(const char* level) {
+    if (_stricmp(level, "warning") == 0 || _stricmp(level, "warn") == 0) return LOG_LEVEL_WARNING;
+    if (_stricmp(level, "error") == 0) return LOG_LEVEL_ERROR;
+    if (_stricmp(level, "none") == 0 || _stricmp(level, "off") == 0) return LOG_LEVEL_NONE;
+    return LOG_LEVEL_INFO;
+}
+
+// TRUE if a record of this level would be written (use before expensive formatting)
+BOOL isLogEnabled(int level) {
+    return g_logEnabled && level >= g_logLevel;
+}
+
+// Make room for extra bytes in the log buffer
+static int reserveLog(size_t extra) {
+    if (g_logBufferUsed + extra <= g_logBufferSize) return 1;
+
+    size_t size = g_logBufferSize ? g_logBufferSize : LOG_BUFFER_SIZE;
+    while (size < g_logBufferUsed + extra) size *= 2;
+    char* buffer = (char*)realloc(g_logBuffer, size);
+    if (!buffer) return 0;
+    g_logBuffer = buffer;
+    g_logBufferSize = size;
+    return 1;
+}
+
+static void appendLog(const char* text, size_t len) {
+    if (!reserveLog(len)) return;
+    memcpy(g_logBuffer + g_logBufferUsed, text, len);
+    g_logBufferUsed += len;
+}
+
+// Append text as the contents of a JSON string
+static void appendLogJson(const char* text) {
+    if (!reserveLog(strlen(text) * 6)) return;
+    char* out = g_logBuffer + g_logBufferUsed;
+    for (; *text; text++) {
+        unsigned char c = (unsigned char)*text;
+        if (c == '"' || c == '\\') {
+            *out++ = '\\';
+            *out++ = (char)c;
+        } else if (c < 0x20) {
+            // \u00XX written by hand: sprintf would add a NUL past the reservation
+            *out++ = '\\';
+            *out++ = 'u';
+            *out++ = '0';
+            *out++ = '0';
+            *out++ = "0123456789abcdef"[c >> 4];
+            *out++ = "0123456789abcdef"[c & 0xf];
+        } else {
+            *out++ = (char)c;
+        }
+    }
+    g_logBufferUsed = out - g_logBuffer;
+}
+
+void initLog(const char* logPath, int overwrite, int level, int format) {
+    if (!logPath || !*logPath || level == LOG_LEVEL_NONE) {
         g_logEnabled = 0;
         return;
     }
 
-    const char* mode = overwrite ? "w" : "a";
-    g_logFile = fopen(logPath, mode);
-    if (g_logFile) {
-        g_logEnabled = 1;
+    strncpy(g_logPath, logPath, sizeof(g_logPath) - 1);
+    g_logOverwrite = overwrite;
+    g_logLevel = level;
+    g_logFormat = format;
+    g_logStartTime = time(NULL);
+    g_logEnabled = 1;
+}
+
+// Write buffered records to the log file (opened on first use)
+void flushLog() {
+    if (!g_logEnabled || g_logBufferUsed == 0) return;
+
+    if (!g_logFile) {
+        g_logFile = fopen(g_logPath, g_logOverwrite ? "w" : "a");
+        if (!g_logFile) {
+            g_logEnabled = 0;
+            return;
+        }
 
-        // Write header
-        time_t now = time(NULL);
+        // Header (timestamp formatted here, localtime may read the zone database)
         char timebuf[64];
-        struct tm* tm_info = localtime(&now);
+        struct tm* tm_info = localtime(&g_logStartTime);
         strftime(timebuf, sizeof(timebuf), "%Y-%m-%d %H:%M:%S", tm_info);
-
-        fprintf(g_logFile, "\n========================================\n");
-        fprintf(g_logFile, "Java Runner Log - %s\n", timebuf);
-        fprintf(g_logFile, "========================================\n");
-        fflush(g_logFile);
+        if (g_logFormat == LOG_FORMAT_JSON) {
+            fprintf(g_logFile, "{\"ts\":0,\"level\":\"INFO\",\"msg\":\"Java Runner Log\",\"time\":\"%s\"}\n", timebuf);
+        } else {
+            fprintf(g_logFile, "\n========================================\n");
+            fprintf(g_logFile, "Java Runner Log - %s\n", timebuf);
+            fprintf(g_logFile, "========================================\n");
+        }
     }
+
+    fwrite(g_logBuffer, 1, g_logBufferUsed, g_logFile);
+    fflush(g_logFile);
+    g_logBufferUsed = 0;
 }
 
 void writeLog(const char* level, const char* format, ...) {
-    if (!g_logEnabled || !g_logFile) return;
+    if (!g_logEnabled || parseLogLevel(level) < g_logLevel) return;
 
+    char message[1024];
+    char* text = message;
     va_list args;
     va_start(args, format);
+    int len = vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    if (len < 0) return;
+
+    if ((size_t)len >= sizeof(message)) {
+        // Long record (e.g. the final command line): format again at full size
+        text = (char*)malloc((size_t)len + 1);
+        if (!text) return;
+        va_start(args, format);
+        vsnprintf(text, (size_t)len + 1, format, args);
+        va_end(args);
+    }
 
-    fprintf(g_logFile, "[%s] ", level);
-    vfprintf(g_logFile, format, args);
-    fprintf(g_logFile, "\n");
-    fflush(g_logFile);
+    if (g_logFormat == LOG_FORMAT_JSON) {
+        char prefix[96];
+        int prefixLen = snprintf(prefix, sizeof(prefix), "{\"ts\":%lld,\"level\":\"%s\",\"msg\":\"",
+                                 getElapsedMicros(), level);
+        appendLog(prefix, (size_t)prefixLen);
+        appendLogJson(text);
+        appendLog("\"}\n", 3);
+    } else {
+        appendLog("[", 1);
+        appendLog(level, strlen(level));
+        appendLog("] ", 2);
+        appendLog(text, (size_t)len);
+        appendLog("\n", 1);
+    }
 
-    va_end(args);
+    if (text != message) free(text);
 }
 
 void closeLog() {
+    if (g_logEnabled && g_logFormat != LOG_FORMAT_JSON) {
+        appendLog("========================================\n\n", 42);
+    }
+    flushLog();
     if (g_logFile) {
-        fprintf(g_logFile, "========================================\n\n");
         fclose(g_logFile);
         g_logFile = NULL;
-        g_logEnabled = 0;
     }
+    free(g_logBuffer);
+    g_logBuffer = NULL;
+    g_logBufferUsed = g_logBufferSize = 0;
+    g_logEnabled = 0;
 }
 
 // Trim whitespace from string (in-place)
@@ -150,6 +589,109 @@ void trim(char* str) {
     }
 }
 
+// Allocate from the arena. Blocks are sized to the request (at least
+// ARENA_BLOCK_SIZE), so a typical launch needs one or two mallocs in total
+void* arenaAlloc(size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    if (!g_arena || g_arena->size - g_arena->used < size) {
+        size_t blockSize = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        ArenaBlock* block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + blockSize);
+        if (!block) return NULL;
+        block->next = g_arena;
+        block->size = blockSize;
+        block->used = 0;
+        g_arena = block;
+    }
+
+    void* result = (char*)(g_arena + 1) + g_arena->used;
+    g_arena->used += size;
+    g_arenaBytes += size;
+    return result;
+}
+
+char* arenaStrdup(const char* str) {
+    size_t len = strlen(str) + 1;
+    char* copy = (char*)arenaAlloc(len);
+    if (copy) memcpy(copy, str, len);
+    return copy;
+}
+
+// Free every arena block; pointers into the arena are invalid afterwards
+void arenaRelease() {
+    while (g_arena) {
+        ArenaBlock* next = g_arena->next;
+        free(g_arena);
+        g_arena = next;
+    }
+}
+
+// Log peak and current resident set size of the launcher
+void logMemoryUsage() {
+    if (!isLogEnabled(LOG_LEVEL_INFO)) return;
+
+    long peakKB = -1;
+    long currentKB = -1;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        peakKB = (long)(counters.PeakWorkingSetSize / 1024);
+        currentKB = (long)(counters.WorkingSetSize / 1024);
+    }
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        peakKB = usage.ru_maxrss / 1024; // bytes on macOS
+#else
+        peakKB = usage.ru_maxrss;
+#endif
+    }
+
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f) {
+        long pages, residentPages;
+        if (fscanf(f, "%ld %ld", &pages, &residentPages) == 2) {
+            currentKB = residentPages * (sysconf(_SC_PAGESIZE) / 1024);
+        }
+        fclose(f);
+    }
+#endif
+
+    writeLog("INFO", "Launcher memory: peak RSS %ld KB, steady RSS %ld KB, arena %lu bytes released",
+             peakKB, currentKB, (unsigned long)g_arenaBytes);
+}
+
+// One line with what java used; compare AOT and non-AOT runs of the same app
+void logChildUsage(const ChildUsage* usage) {
+    if (!isLogEnabled(LOG_LEVEL_INFO)) return;
+
+    char faults[64];
+    if (usage->majorFaults >= 0) {
+        snprintf(faults, sizeof(faults), "%lld major, %lld minor", usage->majorFaults, usage->minorFaults);
+    } else {
+        snprintf(faults, sizeof(faults), "%lld", usage->minorFaults);
+    }
+    writeLog("INFO", "Java resource usage: wall %.3f s, user CPU %.3f s, system CPU %.3f s, "
+             "peak RSS %lld KB, page faults %s",
+             usage->wallMicros / 1e6, usage->userMicros / 1e6, usage->systemMicros / 1e6,
+             usage->peakRssKB, faults);
+}
+
+// Log all executed phases on one line, e.g. "exename=12 console=3 ... spawn=180"
+void logPhaseTimings() {
+    if (!isLogEnabled(LOG_LEVEL_INFO)) return;
+
+    char line[512];
+    int pos = 0;
+    for (int i = 0; i < PHASE_COUNT && pos < (int)sizeof(line); i++) {
+        if (g_phasesRun & (1u << i)) {
+            pos += snprintf(line + pos, sizeof(line) - pos, " %s=%lld", PHASE_NAMES[i], g_phaseMicros[i]);
+        }
+    }
+    line[sizeof(line) - 1] = '\0';
+    writeLog("INFO", "Launcher phases (us):%s", pos > 0 ? line : " none");
+}
+
 // Encode 64-bit number to base52 string
 void encodeBase52(unsigned long long value, char* output, size_t maxLen) {
     if (maxLen < 2) return;
@@ -187,14 +729,65 @@ int getFileInfo(const char* path, unsigned long long* size, unsigned long long*
     return 1;
 }
 
-// Build AOT cache filename: <jarname>.<size_base52>.<modtime_base52>.aot
-void buildAOTCacheName(const char* jarPath, char* aotPath, size_t aotPathSize) {
-    unsigned long long size, modTime;
-    if (!getFileInfo(jarPath, &size, &modTime)) {
-        aotPath[0] = '\0';
-        return;
-    }
+// Check that a path exists and is a regular file (not a directory)
+int isRegularFile(const char* path) {
+#ifdef _WIN32
+    DWORD attrib = GetFileAttributesA(path);
+    return attrib != INVALID_FILE_ATTRIBUTES && !(attrib & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode);
+#endif
+}
+
+// Full-resolution file metadata: changes whenever the file is replaced or rewritten,
+// even within the same second (aot.key=content memo and launch plan validation)
+typedef struct {
+    unsigned long long fileId;     // Inode (POSIX) / file index (Windows)
+    unsigned long long changeTime; // ctime / ChangeTime (ns, 100 ns units on Windows)
+    unsigned long long modTime;    // mtime / LastWriteTime, same units
+    unsigned long long size;
+} FileStamp;
+
+int getFileStamp(const char* path, FileStamp* stamp) {
+    memset(stamp, 0, sizeof(FileStamp));
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+
+    BY_HANDLE_FILE_INFORMATION info;
+    FILE_BASIC_INFO basic;
+    BOOL ok = GetFileInformationByHandle(file, &info) &&
+              GetFileInformationByHandleEx(file, FileBasicInfo, &basic, sizeof(basic));
+    CloseHandle(file);
+    if (!ok) return 0;
+
+    stamp->fileId = ((unsigned long long)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    stamp->changeTime = (unsigned long long)basic.ChangeTime.QuadPart;
+    stamp->modTime = (unsigned long long)basic.LastWriteTime.QuadPart;
+    stamp->size = ((unsigned long long)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+#else
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+#ifdef __APPLE__
+    const struct timespec* ctime = &st.st_ctimespec;
+    const struct timespec* mtime = &st.st_mtimespec;
+#else
+    const struct timespec* ctime = &st.st_ctim;
+    const struct timespec* mtime = &st.st_mtim;
+#endif
+    stamp->fileId = (unsigned long long)st.st_ino;
+    stamp->changeTime = (unsigned long long)ctime->tv_sec * 1000000000ULL + (unsigned long long)ctime->tv_nsec;
+    stamp->modTime = (unsigned long long)mtime->tv_sec * 1000000000ULL + (unsigned long long)mtime->tv_nsec;
+    stamp->size = (unsigned long long)st.st_size;
+#endif
+    return 1;
+}
 
+// Cache file next to the JAR: <jar dir>/<jarname>.<key><suffix>
+void formatCachePath(const char* jarPath, const char* key, const char* suffix,
+                     char* path, size_t pathSize) {
     // Extract directory and filename without extension
     char dirPath[MAX_PATH];
     char baseName[MAX_PATH];
@@ -216,23 +809,95 @@ void buildAOTCacheName(const char* jarPath, char* aotPath, size_t aotPathSize) {
     char* dotPos = strrchr(baseName, '.');
     if (dotPos) *dotPos = '\0';
 
+    // Build final path; a cut-off one is dropped (no cache) rather than used
+    int len;
+    if (dirPath[0]) {
+        len = snprintf(path, pathSize, "%s" PATH_SEP "%s.%s%s", dirPath, baseName, key, suffix);
+    } else {
+        len = snprintf(path, pathSize, "%s.%s%s", baseName, key, suffix);
+    }
+    if (len >= (int)pathSize) path[0] = '\0';
+}
+
+// JAR version part of the cache names: <size_base52>.<modtime_base52>
+// The JVM validates the JAR's size and mtime recorded in a cache, so every name includes them
+int buildJarVersionKey(const char* jarPath, char* key, size_t keySize) {
+    unsigned long long size, modTime;
+    if (!getFileInfo(jarPath, &size, &modTime)) return 0;
+
     // Encode size and modTime to base52
     char sizeStr[32], modTimeStr[32];
     encodeBase52(size, sizeStr, sizeof(sizeStr));
     encodeBase52(modTime, modTimeStr, sizeof(modTimeStr));
+    snprintf(key, keySize, "%s.%s", sizeStr, modTimeStr);
+    return 1;
+}
 
-    // Build final path
-    if (dirPath[0]) {
-        snprintf(aotPath, aotPathSize, "%s\\%s.%s.%s.aot",
-                 dirPath, baseName, sizeStr, modTimeStr);
-    } else {
-        snprintf(aotPath, aotPathSize, "%s.%s.%s.aot",
-                 baseName, sizeStr, modTimeStr);
+// Build AOT cache filename: <jarname>.<size_base52>.<modtime_base52>.aot
+void buildAOTCacheName(const char* jarPath, char* aotPath, size_t aotPathSize) {
+    char key[80];
+    if (!buildJarVersionKey(jarPath, key, sizeof(key))) {
+        aotPath[0] = '\0';
+        return;
+    }
+    formatCachePath(jarPath, key, ".aot", aotPath, aotPathSize);
+}
+
+// A complete checkpoint: CRIU writes inventory.img last
+int hasCRaCImage(const char* cracPath) {
+    char inventory[MAX_PATH];
+    if (!cracPath[0]) return 0;
+    if (snprintf(inventory, sizeof(inventory), "%s" PATH_SEP "inventory.img", cracPath) >= (int)sizeof(inventory)) {
+        return 0;
     }
+    return isRegularFile(inventory);
 }
 
-// Delete outdated AOT cache files for the given JAR
-void cleanupOldAOTFiles(const char* jarPath, const char* currentAOTPath) {
+// Delete a cache file, or a cache directory and the files in it (CRaC images)
+int removeCacheEntry(const char* path) {
+#ifdef _WIN32
+    DWORD attrib = GetFileAttributesA(path);
+    if (attrib == INVALID_FILE_ATTRIBUTES) return 0;
+    if (!(attrib & FILE_ATTRIBUTE_DIRECTORY)) return DeleteFileA(path) != 0;
+
+    char pattern[MAX_PATH];
+    if (snprintf(pattern, sizeof(pattern), "%s\\*", path) >= (int)sizeof(pattern)) return 0;
+    WIN32_FIND_DATAA findData;
+    HANDLE hFind = FindFirstFileA(pattern, &findData);
+    if (hFind != INVALID_HANDLE_VALUE) {
+        do {
+            if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+            char child[MAX_PATH];
+            if (snprintf(child, sizeof(child), "%s\\%s", path, findData.cFileName) >= (int)sizeof(child)) continue;
+            DeleteFileA(child);
+        } while (FindNextFileA(hFind, &findData));
+        FindClose(hFind);
+    }
+    return RemoveDirectoryA(path) != 0;
+#else
+    struct stat st;
+    if (lstat(path, &st) != 0) return 0;
+    if (!S_ISDIR(st.st_mode)) return unlink(path) == 0;
+
+    DIR* dir = opendir(path);
+    if (dir) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+            char child[MAX_PATH];
+            if (snprintf(child, sizeof(child), "%s/%s", path, entry->d_name) >= (int)sizeof(child)) continue;
+            unlink(child);
+        }
+        closedir(dir);
+    }
+    return rmdir(path) == 0;
+#endif
+}
+
+// Delete outdated caches (<jarname>.*<suffix>: .aot files, .crac directories) for
+// the given JAR, keeping currentPath. Returns how many were removed
+int cleanupOldCacheFiles(const char* jarPath, const char* currentPath, const char* suffix) {
+    int removed = 0;
     char dirPath[MAX_PATH];
     char baseName[MAX_PATH];
     char pattern[MAX_PATH];
@@ -247,7 +912,11 @@ void cleanupOldAOTFiles(const char* jarPath, const char* currentAOTPath) {
         dirPath[dirLen] = '\0';
         strcpy(baseName, lastSlash + 1);
     } else {
+#ifdef _WIN32
         GetCurrentDirectoryA(sizeof(dirPath), dirPath);
+#else
+        if (!getcwd(dirPath, sizeof(dirPath))) strcpy(dirPath, ".");
+#endif
         strcpy(baseName, jarPath);
     }
 
@@ -255,34 +924,68 @@ void cleanupOldAOTFiles(const char* jarPath, const char* currentAOTPath) {
     char* dotPos = strrchr(baseName, '.');
     if (dotPos) *dotPos = '\0';
 
-    // Build search pattern: <baseName>.*.aot
-    snprintf(pattern, sizeof(pattern), "%s\\%s.*.aot", dirPath, baseName);
+    // Extract filename from currentPath for comparison
+    const char* currentFileName = strrchr(currentPath, '\\');
+    if (!currentFileName) currentFileName = strrchr(currentPath, '/');
+    if (currentFileName) {
+        currentFileName++;
+    } else {
+        currentFileName = currentPath;
+    }
+    size_t suffixLen = strlen(suffix);
+
+#ifdef _WIN32
+    // Build search pattern: <baseName>.*<suffix> (a cut-off pattern could match other files)
+    if (snprintf(pattern, sizeof(pattern), "%s\\%s.*%s", dirPath, baseName, suffix) >= (int)sizeof(pattern)) {
+        return 0;
+    }
 
-    // Find all matching AOT files
+    // Find all matching cache files
     WIN32_FIND_DATAA findData;
     HANDLE hFind = FindFirstFileA(pattern, &findData);
 
     if (hFind != INVALID_HANDLE_VALUE) {
-        // Extract filename from currentAOTPath for comparison
-        const char* currentFileName = strrchr(currentAOTPath, '\\');
-        if (!currentFileName) currentFileName = strrchr(currentAOTPath, '/');
-        if (currentFileName) {
-            currentFileName++;
-        } else {
-            currentFileName = currentAOTPath;
-        }
-
         do {
-            // Delete if it's not the current AOT file (compare filenames only)
+            // Delete if it's not the current cache (compare filenames only)
             if (_stricmp(findData.cFileName, currentFileName) != 0) {
                 char fullPath[MAX_PATH];
-                snprintf(fullPath, sizeof(fullPath), "%s\\%s", dirPath, findData.cFileName);
-                DeleteFileA(fullPath);
-                writeLog("INFO", "Cleaned up old AOT file: %s", fullPath);
+                if (snprintf(fullPath, sizeof(fullPath), "%s\\%s", dirPath, findData.cFileName) >= (int)sizeof(fullPath)) {
+                    continue;
+                }
+                if (removeCacheEntry(fullPath)) removed++;
+                writeLog("INFO", "Cleaned up old cache: %s", fullPath);
             }
         } while (FindNextFileA(hFind, &findData));
         FindClose(hFind);
     }
+#else
+    // Match <baseName>.*<suffix> by hand, readdir has no wildcard support
+    if (snprintf(pattern, sizeof(pattern), "%s.", baseName) >= (int)sizeof(pattern)) return 0;
+    size_t prefixLen = strlen(pattern);
+
+    DIR* dir = opendir(dirPath);
+    if (dir) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            const char* name = entry->d_name;
+            size_t nameLen = strlen(name);
+            if (nameLen <= prefixLen + suffixLen || strncmp(name, pattern, prefixLen) != 0 ||
+                strcmp(name + nameLen - suffixLen, suffix) != 0) {
+                continue;
+            }
+
+            // Delete if it's not the current cache (compare filenames only)
+            if (strcmp(name, currentFileName) != 0) {
+                char fullPath[MAX_PATH];
+                if (snprintf(fullPath, sizeof(fullPath), "%s/%s", dirPath, name) >= (int)sizeof(fullPath)) continue;
+                if (removeCacheEntry(fullPath)) removed++;
+                writeLog("INFO", "Cleaned up old cache: %s", fullPath);
+            }
+        }
+        closedir(dir);
+    }
+#endif
+    return removed;
 }
 
 // Function to find java executable in PATH
@@ -298,30 +1001,59 @@ int findJavaInPath(const char* exeName, char* outPath, size_t outPathSize) {
         return 0;
     }
 
-    char* token = strtok(pathCopy, ";");
+    char* token = strtok(pathCopy, PATH_LIST_SEP);
     while (token) {
         char testPath[MAX_PATH];
-        snprintf(testPath, sizeof(testPath), "%s\\%s", token, exeName);
-
-        // Check if file exists
-        DWORD attrib = GetFileAttributesA(testPath);
-        if (attrib != INVALID_FILE_ATTRIBUTES && !(attrib & FILE_ATTRIBUTE_DIRECTORY)) {
+        // Check if file exists; a PATH entry too long for a path is skipped
+        if (snprintf(testPath, sizeof(testPath), "%s" PATH_SEP "%s", token, exeName) < (int)sizeof(testPath) &&
+            isRegularFile(testPath)) {
             strncpy(outPath, testPath, outPathSize - 1);
             outPath[outPathSize - 1] = '\0';
             free(pathCopy);
             return 1;
         }
 
-        token = strtok(NULL, ";");
+        token = strtok(NULL, PATH_LIST_SEP);
     }
 
     free(pathCopy);
     return 0;
 }
 
+// Derive the Java home from a java executable path (<home>/bin/java[.exe])
+// On POSIX symlinks are resolved first (/usr/bin/java -> /usr/lib/jvm/.../bin/java)
+int getJavaHome(const char* javaPath, char* javaHome, size_t size) {
+#ifdef _WIN32
+    strncpy(javaHome, javaPath, size - 1);
+    javaHome[size - 1] = '\0';
+#else
+    char resolved[PATH_MAX];
+    if (realpath(javaPath, resolved)) {
+        javaPath = resolved;
+    }
+    strncpy(javaHome, javaPath, size - 1);
+    javaHome[size - 1] = '\0';
+#endif
+
+    // Strip "/java[.exe]" and "/bin"
+    for (int i = 0; i < 2; i++) {
+        char* lastSlash = strrchr(javaHome, '\\');
+        char* lastFwd = strrchr(javaHome, '/');
+        if (lastFwd > lastSlash) lastSlash = lastFwd;
+        if (!lastSlash) return 0;
+        *lastSlash = '\0';
+    }
+    return 1;
+}
+
 // Function to detect if we're in GUI mode (double-clicked from Explorer)
 // Returns: TRUE if GUI mode (should use javaw.exe), FALSE if console mode
 BOOL isGuiMode() {
+#ifndef _WIN32
+    // POSIX has no java/javaw split and no Explorer double-click; the launcher
+    // always behaves as a console program and forwards the exit code
+    return FALSE;
+#else
     // With CONSOLE subsystem, Windows already created a console for us
     // We need to detect if we were launched from a terminal (console mode)
     // or double-clicked from Explorer (GUI mode)
@@ -352,10 +1084,11 @@ BOOL isGuiMode() {
     // Couldn't attach to parent console - we were double-clicked from Explorer
     // Console stays hidden (already hidden above)
     return TRUE;  // GUI mode
+#endif
 }
 
 // Function to show message appropriately (console or GUI)
-void showMessage(BOOL hasConsole, const char* title, const char* message, UINT type) {
+void showMessage(BOOL hasConsole, const char* title, const char* message, unsigned int type) {
     if (hasConsole) {
         // Console mode - use printf
         if (type == MB_ICONERROR) {
@@ -367,28 +1100,79 @@ void showMessage(BOOL hasConsole, const char* title, const char* message, UINT t
         }
         printf("%s\n\n", message);
     } else {
+#ifdef _WIN32
         // GUI mode - use MessageBox
         MessageBoxA(NULL, message, title, type);
+#endif
     }
     writeLog(type == MB_ICONERROR ? "ERROR" : "INFO", "%s: %s", title, message);
 }
 
+// Parse the Java version range of a vm.args.<range> key: "21" (exactly 21),
+// "25+" (25 and later) or "17-21" (inclusive). Returns 0 if malformed
+int parseVersionRange(const char* range, int* minMajor, int* maxMajor) {
+    char* end;
+    long low = strtol(range, &end, 10);
+    if (end == range || low <= 0) return 0;
+
+    *minMajor = (int)low;
+    if (*end == '\0') {
+        *maxMajor = (int)low;
+    } else if (strcmp(end, "+") == 0) {
+        *maxMajor = 0;
+    } else if (*end == '-') {
+        const char* highStart = end + 1;
+        long high = strtol(highStart, &end, 10);
+        if (end == highStart || *end != '\0' || high < low) return 0;
+        *maxMajor = (int)high;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
 // Parse config file (.jrc format)
 // Returns 1 on success, 0 on failure
 int parseConfigFile(const char* configPath, LauncherConfig* config) {
-    FILE* f = fopen(configPath, "r");
+    FILE* f = fopen(configPath, "rb");
     if (!f) return 0;
 
     writeLog("INFO", "Loading config file: %s", configPath);
 
     // Initialize config with defaults
     memset(config, 0, sizeof(LauncherConfig));
+    config->vmArgs = "";
+    config->javaArgs = "";
+    config->appArgs = "";
     config->enableAOT = -1;  // Not specified (use default or cmdline)
+    config->launchMode = -1; // Not specified (spawn unless --exec)
+    config->planCache = 1;   // Launch plans are cached by default
+    config->journal = 1;     // Launches are recorded by default
     config->logOverwrite = 0; // Append by default
+    config->serverIdle = 600; // Warm JVM servers exit after 10 idle minutes
+    config->aotTrainTimeout = 300; // Training workloads are stopped after 5 minutes
     strcpy(config->logLevel, "info");
 
-    char line[MAX_CONFIG_LINE];
-    while (fgets(line, sizeof(line), f)) {
+    // Read the whole file into the arena; values are parsed in place
+    long fileSize = -1;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        fileSize = ftell(f);
+        rewind(f);
+    }
+    char* text = fileSize >= 0 ? (char*)arenaAlloc((size_t)fileSize + 1) : NULL;
+    if (!text) {
+        fclose(f);
+        return 0;
+    }
+    size_t textLen = fread(text, 1, (size_t)fileSize, f);
+    text[textLen] = '\0';
+    fclose(f);
+
+    char* next = text;
+    while (next) {
+        char* line = next;
+        next = strchr(line, '\n');
+        if (next) *next++ = '\0';
         trim(line);
 
         // Skip empty lines and comments
@@ -407,18 +1191,34 @@ int parseConfigFile(const char* configPath, LauncherConfig* config) {
 
         // Parse known keys (matching WinRun4J/jpackage style)
         if (_stricmp(key, "vm.args") == 0) {
-            strncpy(config->vmArgs, value, sizeof(config->vmArgs) - 1);
+            config->vmArgs = value;
             writeLog("INFO", "vm.args=%s", value);
+        } else if (_strnicmp(key, "vm.args.", 8) == 0) {
+            VersionedArgs* entry = &config->versionedVmArgs[config->versionedVmArgsCount];
+            if (config->versionedVmArgsCount < MAX_VERSIONED_ARGS &&
+                parseVersionRange(key + 8, &entry->minMajor, &entry->maxMajor)) {
+                entry->args = value;
+                config->versionedVmArgsCount++;
+                writeLog("INFO", "%s=%s", key, value);
+            } else {
+                writeLog("WARNING", "Ignoring %s (expected vm.args.N, vm.args.N+ or vm.args.N-M)", key);
+            }
         } else if (_stricmp(key, "java.args") == 0) {
-            strncpy(config->javaArgs, value, sizeof(config->javaArgs) - 1);
+            config->javaArgs = value;
             writeLog("INFO", "java.args=%s", value);
         } else if (_stricmp(key, "app.args") == 0) {
-            strncpy(config->appArgs, value, sizeof(config->appArgs) - 1);
+            config->appArgs = value;
             writeLog("INFO", "app.args=%s", value);
         } else if (_stricmp(key, "log.file") == 0) {
             strncpy(config->logFile, value, sizeof(config->logFile) - 1);
+        } else if (_stricmp(key, "trace.file") == 0) {
+            strncpy(config->traceFile, value, sizeof(config->traceFile) - 1);
+        } else if (_stricmp(key, "metrics.dir") == 0) {
+            strncpy(config->metricsDir, value, sizeof(config->metricsDir) - 1);
         } else if (_stricmp(key, "log.level") == 0) {
             strncpy(config->logLevel, value, sizeof(config->logLevel) - 1);
+        } else if (_stricmp(key, "log.format") == 0) {
+            config->logFormat = _stricmp(value, "json") == 0 ? LOG_FORMAT_JSON : LOG_FORMAT_TEXT;
         } else if (_stricmp(key, "log.overwrite") == 0) {
             config->logOverwrite = (_stricmp(value, "true") == 0 || strcmp(value, "1") == 0);
         } else if (_stricmp(key, "aot") == 0) {
@@ -429,10 +1229,72 @@ int parseConfigFile(const char* configPath, LauncherConfig* config) {
                 config->enableAOT = 0;
                 writeLog("INFO", "aot=false");
             }
+        } else if (_stricmp(key, "launch.mode") == 0) {
+            if (_stricmp(value, "exec") == 0) {
+                config->launchMode = LAUNCH_MODE_EXEC;
+            } else if (_stricmp(value, "jni") == 0) {
+                config->launchMode = LAUNCH_MODE_JNI;
+            } else if (_stricmp(value, "spawn") == 0) {
+                config->launchMode = LAUNCH_MODE_SPAWN;
+            }
+            writeLog("INFO", "launch.mode=%s", value);
+        } else if (_stricmp(key, "plan.cache") == 0) {
+            config->planCache = (_stricmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        } else if (_stricmp(key, "journal") == 0) {
+            config->journal = (_stricmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        } else if (_stricmp(key, "ready.signal") == 0) {
+            config->readySignal = (_stricmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        } else if (_stricmp(key, "ready.notify") == 0) {
+            config->readyNotify = (_stricmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        } else if (_stricmp(key, "server") == 0) {
+            if (_stricmp(value, "spare") == 0) {
+                config->serverMode = SERVER_MODE_SPARE;
+            } else if (_stricmp(value, "true") == 0 || strcmp(value, "1") == 0) {
+                config->serverMode = SERVER_MODE_SHARED;
+            } else {
+                config->serverMode = SERVER_MODE_OFF;
+            }
+            writeLog("INFO", "server=%s", value);
+        } else if (_stricmp(key, "aot.background") == 0) {
+            config->aotBackground = (_stricmp(value, "true") == 0 || strcmp(value, "1") == 0);
+            writeLog("INFO", "aot.background=%s", value);
+        } else if (_stricmp(key, "aot.key") == 0) {
+            if (_stricmp(value, "content") == 0) {
+                config->aotContentKey = 1;
+            } else if (_stricmp(value, "mtime") == 0) {
+                config->aotContentKey = 0;
+            } else {
+                writeLog("WARNING", "Ignoring aot.key=%s (expected content or mtime)", value);
+            }
+            writeLog("INFO", "aot.key=%s", value);
+        } else if (_stricmp(key, "aot.train.args") == 0) {
+            config->aotTrainArgs = value;
+            writeLog("INFO", "aot.train.args=%s", value);
+        } else if (_stricmp(key, "aot.train.env") == 0) {
+            config->aotTrainEnv = value;
+            writeLog("INFO", "aot.train.env=%s", value);
+        } else if (_stricmp(key, "aot.train.timeout") == 0) {
+            int seconds = atoi(value);
+            if (seconds >= 0) {
+                config->aotTrainTimeout = seconds;
+            } else {
+                writeLog("WARNING", "Ignoring aot.train.timeout=%s (expected seconds, 0 = no limit)", value);
+            }
+        } else if (_stricmp(key, "crac") == 0) {
+            config->crac = (_stricmp(value, "true") == 0 || strcmp(value, "1") == 0);
+            writeLog("INFO", "crac=%s", value);
+        } else if (_stricmp(key, "single.instance") == 0) {
+            config->singleInstance = (_stricmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        } else if (_stricmp(key, "server.idle") == 0) {
+            int idle = atoi(value);
+            if (idle > 0) {
+                config->serverIdle = idle;
+            } else {
+                writeLog("WARNING", "Ignoring server.idle=%s (expected seconds > 0)", value);
+            }
         }
     }
 
-    fclose(f);
     return 1;
 }
 
@@ -448,6 +1310,11 @@ int createConfigFile(const char* configPath, const char* jarPath) {
     fprintf(f, "# VM arguments (passed before -jar, launcher auto-injects AOT flags here)\n");
     fprintf(f, "#vm.args=-Xmx512m -Xms128m -Dapp.mode=production\n\n");
 
+    fprintf(f, "# Extra VM arguments for specific Java versions, appended after vm.args\n");
+    fprintf(f, "# vm.args.N (exactly N), vm.args.N+ (N and later), vm.args.N-M (N to M)\n");
+    fprintf(f, "#vm.args.25+=-XX:+UseCompactObjectHeaders\n");
+    fprintf(f, "#vm.args.17-24=-XX:TieredStopAtLevel=1\n\n");
+
     fprintf(f, "# Java arguments (everything after VM args: -jar, -cp, class name, etc.)\n");
     if (jarPath && *jarPath) {
         fprintf(f, "java.args=-jar %s\n\n", jarPath);
@@ -462,19 +1329,90 @@ int createConfigFile(const char* configPath, const char* jarPath) {
     fprintf(f, "# AOT cache control (optional, default: true)\n");
     fprintf(f, "#aot=true\n\n");
 
+    fprintf(f, "# Create a missing AOT cache in a separate low-priority run instead of this launch\n");
+    fprintf(f, "# (optional, default: false)\n");
+    fprintf(f, "#aot.background=true\n\n");
+
+    fprintf(f, "# Also key the cache files on the JAR's content, not just its size and mtime\n");
+    fprintf(f, "# (optional, default: mtime)\n");
+    fprintf(f, "#aot.key=content\n\n");
+
+    fprintf(f, "# Training workload for that run (optional, implies aot.background): its arguments\n");
+    fprintf(f, "# replace the command-line arguments, JDK 24+ records it with -XX:AOTMode=record.\n");
+    fprintf(f, "# The workload is stopped after aot.train.timeout seconds (default: 300, 0 = never)\n");
+    fprintf(f, "#aot.train.args=--self-test\n");
+    fprintf(f, "#aot.train.env=APP_PROFILE=training \"DATA_DIR=/tmp/app training\"\n");
+    fprintf(f, "#aot.train.timeout=300\n\n");
+
+    fprintf(f, "# Launch mode (optional, default: spawn)\n");
+    fprintf(f, "# exec = replace the launcher with java (Linux/POSIX only, same PID, no waiting launcher)\n");
+    fprintf(f, "# jni  = load the JVM library into the launcher process (no second process)\n");
+    fprintf(f, "#launch.mode=spawn\n\n");
+
+    fprintf(f, "# Reuse the resolved launch (Java path, AOT decision, arguments) while nothing changed (optional, default: true)\n");
+    fprintf(f, "#plan.cache=true\n\n");
+
+    fprintf(f, "# Record each launch for \"jr --stats\" (optional, default: true)\n");
+    fprintf(f, "#journal=true\n\n");
+
+    fprintf(f, "# Startup timeline in Chrome trace-event JSON: launcher phases and JVM startup\n");
+    fprintf(f, "# (optional, open in chrome://tracing or ui.perfetto.dev)\n");
+    fprintf(f, "#trace.file=launcher-trace.json\n\n");
+
+    fprintf(f, "# Prometheus metrics: rewrite jr_<app>.prom in this directory after each launch\n");
+    fprintf(f, "# (optional, point it at the node_exporter textfile collector directory)\n");
+    fprintf(f, "#metrics.dir=/var/lib/node_exporter/textfile_collector\n\n");
+
+    fprintf(f, "# Readiness: the app calls jarrunner.JarRunner.ready() when it is initialized and the\n");
+    fprintf(f, "# launcher records the time to ready (optional, default: false)\n");
+    fprintf(f, "#ready.signal=true\n");
+    fprintf(f, "# Also send READY=1 to systemd (Type=notify services, implies ready.signal)\n");
+    fprintf(f, "#ready.notify=true\n\n");
+
+    fprintf(f, "# Warm JVM: true runs every launch in one resident JVM for this JAR, spare gives\n");
+    fprintf(f, "# each launch a fresh pre-started JVM (optional, default: false, needs Java 16+\n");
+    fprintf(f, "# and the jarrunner classes in the JAR)\n");
+    fprintf(f, "#server=true\n");
+    fprintf(f, "# Seconds without a launch before the server exits (default: 600)\n");
+    fprintf(f, "#server.idle=600\n\n");
+
+    fprintf(f, "# CRaC: the first run of a JAR version checkpoints at jarrunner.JarRunner.ready(),\n");
+    fprintf(f, "# later runs restore from <jarname>.<size>.<mtime>.<args>.crac (optional, default: false,\n");
+    fprintf(f, "# needs a CRaC JDK on Linux, uses the AOT cache otherwise). A restore runs with the\n");
+    fprintf(f, "# arguments of the checkpoint run and ignores new ones: launches with command-line\n");
+    fprintf(f, "# arguments do not use CRaC, and editing vm.args/java.args/app.args takes a new checkpoint\n");
+    fprintf(f, "#crac=true\n\n");
+
+    fprintf(f, "# Single instance: later launches hand their arguments to the running app, which\n");
+    fprintf(f, "# listens with jarrunner.JarRunnerInstance (optional, default: false, Java 16+)\n");
+    fprintf(f, "#single.instance=true\n\n");
+
     fprintf(f, "# Debug logging (optional, only used when specified)\n");
     fprintf(f, "#log.file=launcher.log\n");
     fprintf(f, "#log.level=info\n");
+    fprintf(f, "#log.format=text\n");
     fprintf(f, "#log.overwrite=false\n");
 
     fclose(f);
     return 1;
 }
 
+// Get the executable's own full path
+void getExePath(char* exePath, size_t size) {
+#ifdef _WIN32
+    GetModuleFileNameA(NULL, exePath, (DWORD)size);
+    exePath[size - 1] = '\0';
+#else
+    ssize_t len = readlink("/proc/self/exe", exePath, size - 1);
+    if (len < 0) len = 0;
+    exePath[len] = '\0';
+#endif
+}
+
 // Get the executable's own filename (without .exe extension)
 void getExeBaseName(char* baseName, size_t size) {
     char exePath[MAX_PATH];
-    GetModuleFileNameA(NULL, exePath, sizeof(exePath));
+    getExePath(exePath, sizeof(exePath));
 
     // Get just the filename
     const char* lastSlash = strrchr(exePath, '\\');
@@ -494,8 +1432,7 @@ void getExeBaseName(char* baseName, size_t size) {
 // Get the executable's full path (without .exe extension)
 // This is used for finding the .jrc config file in the same directory as the .exe
 void getExeFullPathWithoutExt(char* fullPath, size_t size) {
-    GetModuleFileNameA(NULL, fullPath, size);
-    fullPath[size - 1] = '\0';
+    getExePath(fullPath, size);
 
     // Remove .exe extension
     char* dotPos = strrchr(fullPath, '.');
@@ -504,391 +1441,3416 @@ void getExeFullPathWithoutExt(char* fullPath, size_t size) {
     }
 }
 
-// Function to parse --java-home argument
-char* extractJavaHome(const char* cmdLine) {
-    const char* javaHomeArg = strstr(cmdLine, "--java-home=");
-    if (!javaHomeArg) {
-        javaHomeArg = strstr(cmdLine, "--java-home ");
-        if (javaHomeArg) {
-            javaHomeArg += 12; // Skip "--java-home "
-            // Find the end (next space or quote)
-            const char* end = strchr(javaHomeArg, ' ');
-            if (!end) end = javaHomeArg + strlen(javaHomeArg);
-
-            size_t len = end - javaHomeArg;
-            char* result = (char*)malloc(len + 1);
-            if (result) {
-                strncpy(result, javaHomeArg, len);
-                result[len] = '\0';
-            }
-            return result;
-        }
-        return NULL;
-    }
-
-    javaHomeArg += 12; // Skip "--java-home="
-
-    // Handle quoted paths
-    if (*javaHomeArg == '"') {
-        javaHomeArg++;
-        const char* endQuote = strchr(javaHomeArg, '"');
-        if (!endQuote) return NULL;
-
-        size_t len = endQuote - javaHomeArg;
-        char* result = (char*)malloc(len + 1);
-        if (result) {
-            strncpy(result, javaHomeArg, len);
-            result[len] = '\0';
-        }
-        return result;
+// Append an arena string to the list without copying. Returns 0 if out of memory
+static int argListPush(ArgList* list, char* arg) {
+    if (list->count + 2 > list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 16;
+        char** items = (char**)arenaAlloc(capacity * sizeof(char*));
+        if (!items) return 0;
+        if (list->count) memcpy(items, list->items, list->count * sizeof(char*));
+        list->items = items;
+        list->capacity = capacity;
     }
 
-    // Unquoted path - find next space
-    const char* end = strchr(javaHomeArg, ' ');
-    if (!end) end = javaHomeArg + strlen(javaHomeArg);
+    list->items[list->count++] = arg;
+    list->items[list->count] = NULL;
+    return 1;
+}
 
-    size_t len = end - javaHomeArg;
-    char* result = (char*)malloc(len + 1);
-    if (result) {
-        strncpy(result, javaHomeArg, len);
-        result[len] = '\0';
-    }
-    return result;
+// Append a copy of arg to the list. Returns 0 if out of memory
+int argListAdd(ArgList* list, const char* arg) {
+    char* copy = arenaStrdup(arg);
+    return copy && argListPush(list, copy);
 }
 
-// Function to remove --java-home from command line
-void removeJavaHomeArg(char* cmdLine) {
-    char* javaHomeArg = strstr(cmdLine, "--java-home");
-    if (!javaHomeArg) return;
+// Read the next argument of a command string using the Windows (MS CRT) rules,
+// so .jrc values tokenize exactly as java.exe would parse them on Windows:
+// quotes group words and may appear mid-argument (-XX:AOTCache="a b.aot"),
+// 2n backslashes + quote give n backslashes, 2n+1 give n and a literal quote,
+// other backslashes are literal. out needs strlen(*input) + 1 bytes
+// Returns 0 when no argument is left
+int nextArgument(const char** input, char* out) {
+    const char* in = *input;
+    while (*in == ' ' || *in == '\t') in++;
+    if (!*in) {
+        *input = in;
+        return 0;
+    }
 
-    // Find the end of the argument
-    char* argEnd = javaHomeArg;
-    if (strncmp(javaHomeArg, "--java-home=", 12) == 0) {
-        argEnd += 12;
-        // Skip quoted or unquoted path
-        if (*argEnd == '"') {
-            argEnd = strchr(argEnd + 1, '"');
-            if (argEnd) argEnd++;
-        } else {
-            while (*argEnd && *argEnd != ' ') argEnd++;
-        }
-    } else {
-        argEnd += 11; // Skip "--java-home"
-        while (*argEnd == ' ') argEnd++; // Skip spaces
-        // Skip the path value
-        if (*argEnd == '"') {
-            argEnd = strchr(argEnd + 1, '"');
-            if (argEnd) argEnd++;
+    int inQuotes = 0;
+    while (*in && (inQuotes || (*in != ' ' && *in != '\t'))) {
+        if (*in == '\\') {
+            size_t backslashes = 0;
+            while (*in == '\\') {
+                backslashes++;
+                in++;
+            }
+            if (*in == '"') {
+                for (size_t i = 0; i < backslashes / 2; i++) *out++ = '\\';
+                if (backslashes % 2) {
+                    *out++ = '"';
+                    in++;
+                }
+            } else {
+                for (size_t i = 0; i < backslashes; i++) *out++ = '\\';
+            }
+        } else if (*in == '"') {
+            // "" inside quotes is a literal quote
+            if (inQuotes && in[1] == '"') {
+                *out++ = '"';
+                in += 2;
+            } else {
+                inQuotes = !inQuotes;
+                in++;
+            }
         } else {
-            while (*argEnd && *argEnd != ' ') argEnd++;
+            *out++ = *in++;
         }
     }
 
-    // Skip trailing space
-    if (*argEnd == ' ') argEnd++;
-
-    // Remove by shifting the rest of the string
-    memmove(javaHomeArg, argEnd, strlen(argEnd) + 1);
+    *out = '\0';
+    *input = in;
+    return 1;
 }
 
-// Extract JAR file path from command line arguments
-void extractJarPath(const char* args, char* jarPath, size_t jarPathSize) {
-    if (!args || !*args) {
-        jarPath[0] = '\0';
-        return;
+// Tokenize a command string (vm.args, java.args, ...) and append every argument
+// Arguments never take more room than their source text, so all of them are
+// unpacked back to back into one arena buffer of the input's size
+int argListAddParsed(ArgList* list, const char* str) {
+    char* out = (char*)arenaAlloc(strlen(str) + 1);
+    if (!out) return 0;
+
+    while (nextArgument(&str, out)) {
+        if (!argListPush(list, out)) return 0;
+        out += strlen(out) + 1;
     }
+    return 1;
+}
 
-    const char* jarStart = strstr(args, "-jar ");
-    if (!jarStart) {
-        jarPath[0] = '\0';
-        return;
+// Join an argument vector into one command line that nextArgument() and the
+// MS CRT split back into the same vector (CreateProcess input, log output)
+// The result lives in the arena
+char* joinArguments(char** args, int count) {
+    size_t size = 1;
+    for (int i = 0; i < count; i++) {
+        size += strlen(args[i]) * 2 + 3;
     }
 
-    jarStart += 5; // Skip "-jar "
-    while (*jarStart == ' ') jarStart++; // Skip spaces
+    char* cmdLine = (char*)arenaAlloc(size);
+    if (!cmdLine) return NULL;
 
-    // Parse JAR file path (handle quoted and unquoted paths)
-    if (*jarStart == '"') {
-        jarStart++;
-        const char* jarEnd = strchr(jarStart, '"');
-        if (jarEnd) {
-            size_t len = jarEnd - jarStart;
-            if (len < jarPathSize) {
-                strncpy(jarPath, jarStart, len);
-                jarPath[len] = '\0';
-                return;
+    char* out = cmdLine;
+    for (int i = 0; i < count; i++) {
+        const char* arg = args[i];
+        if (i > 0) *out++ = ' ';
+
+        if (*arg && !strpbrk(arg, " \t\"")) {
+            size_t len = strlen(arg);
+            memcpy(out, arg, len);
+            out += len;
+            continue;
+        }
+
+        *out++ = '"';
+        while (*arg) {
+            size_t backslashes = 0;
+            while (*arg == '\\') {
+                backslashes++;
+                arg++;
+            }
+            if (!*arg) {
+                // Double trailing backslashes so they don't escape the closing quote
+                backslashes *= 2;
+            } else if (*arg == '"') {
+                backslashes = backslashes * 2 + 1;
             }
+            for (size_t b = 0; b < backslashes; b++) *out++ = '\\';
+            if (*arg) *out++ = *arg++;
         }
+        *out++ = '"';
+    }
+    *out = '\0';
+    return cmdLine;
+}
+
+// Take the leading launcher options off the command line. Scanning stops at the
+// first other argument (the JAR or an application argument) or after "--", so
+// an application's own --exec or --java-home is never swallowed
+void parseLauncherOptions(int argc, char** argv, LauncherOptions* options) {
+    memset(options, 0, sizeof(LauncherOptions));
+    options->enableAOT = -1;
+    options->launchMode = -1;
+
+    int i = 1;
+    while (i < argc) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--java-home=", 12) == 0) {
+            options->javaHome = arg + 12;
+        } else if (strcmp(arg, "--java-home") == 0 && i + 1 < argc) {
+            options->javaHome = argv[++i];
+        } else if (strcmp(arg, "--disable-aot") == 0) {
+            options->enableAOT = 0;
+        } else if (strcmp(arg, "--enable-aot") == 0) {
+            options->enableAOT = 1;
+        } else if (strcmp(arg, "--exec") == 0) {
+            options->launchMode = LAUNCH_MODE_EXEC;
+        } else if (strcmp(arg, "--no-plan-cache") == 0) {
+            options->noPlanCache = 1;
+        } else if (strncmp(arg, "--trace=", 8) == 0) {
+            options->traceFile = arg + 8;
+        } else if (strcmp(arg, "--stats") == 0) {
+            options->stats = 1;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                options->statsApp = argv[++i];
+            }
+        } else if (strcmp(arg, "--create-config") == 0) {
+            options->createConfig = 1;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                options->createConfigJar = argv[++i];
+            }
+        } else if (strcmp(arg, "--aot-train") == 0) {
+            options->aotTrain = 1;
+            i++;
+            break;
+        } else if (strcmp(arg, "--") == 0) {
+            i++;
+            break;
+        } else {
+            break;
+        }
+        i++;
+    }
+
+    options->appArgs = argv + i;
+    options->appArgCount = argc - i;
+}
+
+#ifndef _WIN32
+// Wait for a spawned child and return its exit code (128+signal if killed)
+// Uses a pidfd where available so the wait can never hit a recycled PID.
+// The raw waitid syscall also reports the child's rusage, which glibc's
+// waitid() wrapper drops; it is stored in *usage when usage is not NULL
+int waitForChild(pid_t pid, ChildUsage* usage) {
+    siginfo_t info;
+    struct rusage ru;
+    memset(&info, 0, sizeof(info));
+    memset(&ru, 0, sizeof(ru));
+
+    int pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    long rc;
+    if (pidfd >= 0) {
+        do {
+            rc = syscall(SYS_waitid, P_PIDFD, pidfd, &info, WEXITED, &ru);
+        } while (rc != 0 && errno == EINTR);
+        close(pidfd);
+    } else {
+        // Kernel older than 5.3: plain PID wait
+        do {
+            rc = syscall(SYS_waitid, P_PID, pid, &info, WEXITED, &ru);
+        } while (rc != 0 && errno == EINTR);
+    }
+
+    if (rc != 0) return 1;
+    if (usage) {
+        usage->valid = 1;
+        usage->userMicros = (long long)ru.ru_utime.tv_sec * 1000000 + ru.ru_utime.tv_usec;
+        usage->systemMicros = (long long)ru.ru_stime.tv_sec * 1000000 + ru.ru_stime.tv_usec;
+        usage->peakRssKB = ru.ru_maxrss;
+        usage->majorFaults = ru.ru_majflt;
+        usage->minorFaults = ru.ru_minflt;
+    }
+    if (info.si_code == CLD_EXITED) return info.si_status;
+    return 128 + info.si_status;
+}
+#endif
+
+#ifdef JR_JNI_HOSTING
+// In-process JVM hosting (launch.mode=jni)
+// Loads the JVM library of the resolved Java home and runs the main class through
+// JNI_CreateJavaVM, skipping the second process creation and argument re-parse
+
+typedef jint (JNICALL *CreateJavaVM_t)(JavaVM** vm, void** env, void* args);
+
+// sun.launcher.LauncherHelper load modes (same values the JDK's java.c uses)
+#define LM_CLASS 1
+#define LM_JAR 2
+
+// Stack for the thread running main(), matches the JDK launcher's 64-bit default
+#define JNI_MAIN_STACK_SIZE (1024 * 1024)
+
+typedef struct {
+    CreateJavaVM_t createJavaVM;
+    JavaVMOption* options;
+    int optionCount;
+    int mode;                // LM_CLASS or LM_JAR
+    const char* mainSpec;    // Class name or JAR path
+    char** appArgs;
+    int appArgCount;
+    int vmCreated;
+    int exitCode;
+} JniLaunch;
+
+// Called by the JVM on System.exit(), the launcher never regains control after it
+static void JNICALL jniExitHook(jint code) {
+    writeLog("INFO", "Hosted JVM exited with code: %d", (int)code);
+    closeLog();
+}
+
+// VM options that JNI_CreateJavaVM understands directly. Everything else in
+// vm.args (--add-opens, --module-path, @argfiles, ...) is java launcher
+// syntax and makes the caller fall back to spawning java
+static int isHostableVmOption(const char* arg) {
+    static const char* prefixes[] = {
+        "-D", "-X", "-ea", "-da", "-esa", "-dsa", "-enableassertions", "-disableassertions",
+        "-enablesystemassertions", "-disablesystemassertions", "-verbose",
+        "-agentlib:", "-agentpath:", "-javaagent:", NULL
+    };
+    for (int i = 0; prefixes[i]; i++) {
+        if (strncmp(arg, prefixes[i], strlen(prefixes[i])) == 0) return 1;
+    }
+    return 0;
+}
+
+// Find the JVM library for a java executable path (<home>/bin/java)
+static int findJvmLibrary(const char* javaPath, char* libPath, size_t libPathSize) {
+    char javaHome[MAX_PATH];
+    if (!getJavaHome(javaPath, javaHome, sizeof(javaHome))) return 0;
+
+#ifdef _WIN32
+    static const char* candidates[] = { "\\bin\\server\\jvm.dll", "\\bin\\client\\jvm.dll", NULL };
+#elif defined(__APPLE__)
+    static const char* candidates[] = { "/lib/server/libjvm.dylib", NULL };
+#else
+    static const char* candidates[] = { "/lib/server/libjvm.so", "/lib/client/libjvm.so", NULL };
+#endif
+
+    for (int i = 0; candidates[i]; i++) {
+        if (snprintf(libPath, libPathSize, "%s%s", javaHome, candidates[i]) >= (int)libPathSize) continue;
+        if (isRegularFile(libPath)) return 1;
+    }
+    return 0;
+}
+
+// Resolve the main class and invoke static main(String[]) like java.c does
+static int runMainClass(JNIEnv* env, JniLaunch* launch) {
+    jclass helper = (*env)->FindClass(env, "sun/launcher/LauncherHelper");
+    jmethodID checkAndLoadMain = helper ? (*env)->GetStaticMethodID(env, helper,
+        "checkAndLoadMain", "(ZILjava/lang/String;)Ljava/lang/Class;") : NULL;
+    if (!checkAndLoadMain) {
+        (*env)->ExceptionDescribe(env);
+        return 1;
+    }
+
+    jstring mainSpec = (*env)->NewStringUTF(env, launch->mainSpec);
+    jclass mainClass = (jclass)(*env)->CallStaticObjectMethod(env, helper, checkAndLoadMain,
+                                                              JNI_TRUE, (jint)launch->mode, mainSpec);
+    if ((*env)->ExceptionCheck(env) || !mainClass) {
+        (*env)->ExceptionDescribe(env);
+        return 1;
+    }
+
+    // Instance/no-arg main methods (JDK 25 JEP 512) need the full java launcher
+    jmethodID mainMethod = (*env)->GetStaticMethodID(env, mainClass, "main", "([Ljava/lang/String;)V");
+    if (!mainMethod) {
+        (*env)->ExceptionDescribe(env);
+        fprintf(stderr, "launch.mode=jni requires a static main(String[]) method\n");
+        return 1;
+    }
+
+    jclass stringClass = (*env)->FindClass(env, "java/lang/String");
+    jobjectArray args = (*env)->NewObjectArray(env, launch->appArgCount, stringClass, NULL);
+    for (int i = 0; args && i < launch->appArgCount; i++) {
+        jstring arg = (*env)->NewStringUTF(env, launch->appArgs[i]);
+        (*env)->SetObjectArrayElement(env, args, i, arg);
+        (*env)->DeleteLocalRef(env, arg);
+    }
+    if ((*env)->ExceptionCheck(env)) {
+        (*env)->ExceptionDescribe(env);
+        return 1;
+    }
+
+    (*env)->CallStaticVoidMethod(env, mainClass, mainMethod, args);
+    if ((*env)->ExceptionCheck(env)) {
+        (*env)->ExceptionDescribe(env);
+        return 1;
+    }
+    return 0;
+}
+
+// Create the VM and run main; executed on a fresh thread on POSIX because the
+// primordial thread ignores -Xss and has no guard pages for the JVM to manage
+static void* jniMainThread(void* arg) {
+    JniLaunch* launch = (JniLaunch*)arg;
+    JavaVM* vm = NULL;
+    JNIEnv* env = NULL;
+
+    JavaVMInitArgs vmArgs;
+    memset(&vmArgs, 0, sizeof(vmArgs));
+    vmArgs.version = JNI_VERSION_1_8;
+    vmArgs.nOptions = launch->optionCount;
+    vmArgs.options = launch->options;
+    vmArgs.ignoreUnrecognized = JNI_FALSE;
+
+    if (launch->createJavaVM(&vm, (void**)&env, &vmArgs) != JNI_OK) {
+        launch->vmCreated = 0;
+        return NULL;
+    }
+    launch->vmCreated = 1;
+
+    launch->exitCode = runMainClass(env, launch);
+
+    // DestroyJavaVM waits for the application's remaining non-daemon threads
+    (*vm)->DetachCurrentThread(vm);
+    (*vm)->DestroyJavaVM(vm);
+    return NULL;
+}
+
+// Run the final java argument vector inside this process
+// Returns FALSE if it cannot be hosted (launcher-only options, no JVM library,
+// VM creation failed) so the caller can spawn java instead
+BOOL hostJavaInProcess(const char* javaPath, char** argv, int argc, int* exitCode) {
+    char libPath[MAX_PATH];
+    if (!findJvmLibrary(javaPath, libPath, sizeof(libPath))) {
+        writeLog("WARNING", "JVM library not found next to %s", javaPath);
+        return FALSE;
+    }
+
+    JniLaunch launch;
+    memset(&launch, 0, sizeof(launch));
+    launch.options = (JavaVMOption*)calloc(argc + 3, sizeof(JavaVMOption));
+    char* classPathOpt = NULL;
+    char* commandOpt = NULL;
+    BOOL hostable = FALSE;
+
+    // argv[0] is java itself: [vm options] (-jar <jar> | -cp <path> <class>) [app args]
+    int i = 1;
+    for (; launch.options && i < argc && isHostableVmOption(argv[i]); i++) {
+        launch.options[launch.optionCount++].optionString = argv[i];
+    }
+
+    if (launch.options && i + 1 < argc) {
+        const char* classPath = NULL;
+        if (strcmp(argv[i], "-jar") == 0) {
+            launch.mode = LM_JAR;
+            launch.mainSpec = argv[i + 1];
+            classPath = argv[i + 1];
+            i += 2;
+        } else if ((strcmp(argv[i], "-cp") == 0 || strcmp(argv[i], "-classpath") == 0 ||
+                    strcmp(argv[i], "--class-path") == 0) && i + 2 < argc) {
+            launch.mode = LM_CLASS;
+            classPath = argv[i + 1];
+            launch.mainSpec = argv[i + 2];
+            i += 3;
+        }
+
+        if (classPath) {
+            size_t cpLen = strlen(classPath) + 32;
+            classPathOpt = (char*)malloc(cpLen);
+            commandOpt = (char*)malloc(strlen(launch.mainSpec) + 32);
+            if (classPathOpt && commandOpt) {
+                snprintf(classPathOpt, cpLen, "-Djava.class.path=%s", classPath);
+                snprintf(commandOpt, strlen(launch.mainSpec) + 32, "-Dsun.java.command=%s", launch.mainSpec);
+                launch.options[launch.optionCount++].optionString = classPathOpt;
+                launch.options[launch.optionCount++].optionString = commandOpt;
+                launch.options[launch.optionCount].optionString = "exit";
+                launch.options[launch.optionCount++].extraInfo = (void*)jniExitHook;
+                launch.appArgs = argv + i;
+                launch.appArgCount = argc - i;
+                hostable = TRUE;
+            }
+        }
+    }
+
+    if (!hostable) {
+        writeLog("WARNING", "Command uses java launcher options that cannot be hosted in-process");
+    } else {
+#ifdef _WIN32
+        HMODULE jvmLib = LoadLibraryA(libPath);
+        launch.createJavaVM = jvmLib ? (CreateJavaVM_t)GetProcAddress(jvmLib, "JNI_CreateJavaVM") : NULL;
+#else
+        void* jvmLib = dlopen(libPath, RTLD_NOW | RTLD_GLOBAL);
+        launch.createJavaVM = jvmLib ? (CreateJavaVM_t)dlsym(jvmLib, "JNI_CreateJavaVM") : NULL;
+#endif
+        if (!launch.createJavaVM) {
+            writeLog("WARNING", "Could not load JNI_CreateJavaVM from %s", libPath);
+        } else {
+            writeLog("INFO", "Hosting JVM in-process: %s", libPath);
+#ifdef _WIN32
+            jniMainThread(&launch);
+#else
+            pthread_t thread;
+            pthread_attr_t attr;
+            pthread_attr_init(&attr);
+            pthread_attr_setstacksize(&attr, JNI_MAIN_STACK_SIZE);
+            if (pthread_create(&thread, &attr, jniMainThread, &launch) == 0) {
+                pthread_join(thread, NULL);
+            } else {
+                jniMainThread(&launch);
+            }
+            pthread_attr_destroy(&attr);
+#endif
+            if (!launch.vmCreated) {
+                writeLog("WARNING", "JNI_CreateJavaVM failed");
+            }
+        }
+    }
+
+    free(classPathOpt);
+    free(commandOpt);
+    free(launch.options);
+
+    if (!launch.vmCreated) return FALSE;
+
+    *exitCode = launch.exitCode;
+    writeLog("INFO", "Hosted JVM finished with code: %d", launch.exitCode);
+    return TRUE;
+}
+#endif
+
+// Readiness channel (ready.signal)
+// java gets the write end of an inherited pipe (-Djarrunner.ready.fd=N) on
+// POSIX or the name of a pipe the launcher serves (-Djarrunner.ready.pipe=NAME)
+// on Windows. jarrunner.JarRunner.ready() writes one byte to it once the app
+// has initialized; the launcher notes when that byte arrived. End of file
+// (java exited or closed the channel without signalling) means never ready
+
+typedef struct {
+    char arg[128];                 // Property passed to java
+#ifdef _WIN32
+    HANDLE pipe;
+    OVERLAPPED overlapped;         // Pending connect/read, event signalled on completion
+    BOOL connected;                // java connected before the launcher started waiting
+    HANDLE process;                // java, set by launchProcess before waiting
+#else
+    int readFd;
+    int writeFd;                   // Inherited by java, closed in the launcher after the spawn
+#endif
+    long long readyMicros;         // Launcher time the ready byte arrived (0 = not ready)
+} ReadyChannel;
+
+BOOL openReadyChannel(ReadyChannel* channel) {
+    memset(channel, 0, sizeof(ReadyChannel));
+#ifdef _WIN32
+    char pipeName[64];
+    snprintf(pipeName, sizeof(pipeName), "\\\\.\\pipe\\jr-ready-%lu", GetCurrentProcessId());
+    channel->pipe = CreateNamedPipeA(pipeName, PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                     PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, 0, 16, 0, NULL);
+    if (channel->pipe == INVALID_HANDLE_VALUE) return FALSE;
+    channel->overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (!channel->overlapped.hEvent) {
+        CloseHandle(channel->pipe);
+        return FALSE;
+    }
+
+    // Accept the connection in the background; java may connect at any time
+    if (!ConnectNamedPipe(channel->pipe, &channel->overlapped)) {
+        channel->connected = GetLastError() == ERROR_PIPE_CONNECTED;
+    }
+    snprintf(channel->arg, sizeof(channel->arg), "-Djarrunner.ready.pipe=%s", pipeName);
+#else
+    int fds[2];
+    if (pipe(fds) != 0) {
+        channel->readFd = channel->writeFd = -1;
+        return FALSE;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    channel->readFd = fds[0];
+    channel->writeFd = fds[1];
+    snprintf(channel->arg, sizeof(channel->arg), "-Djarrunner.ready.fd=%d", fds[1]);
+#endif
+    return TRUE;
+}
+
+// Safe to call more than once
+void closeReadyChannel(ReadyChannel* channel) {
+#ifdef _WIN32
+    if (channel->pipe) {
+        CancelIo(channel->pipe);
+        CloseHandle(channel->pipe);
+        CloseHandle(channel->overlapped.hEvent);
+        channel->pipe = NULL;
+    }
+#else
+    if (channel->writeFd >= 0) close(channel->writeFd);
+    if (channel->readFd >= 0) close(channel->readFd);
+    channel->writeFd = channel->readFd = -1;
+#endif
+}
+
+#ifdef _WIN32
+// Wait until the pending pipe operation completes (TRUE) or java exits (FALSE)
+static BOOL waitForReadyPipe(ReadyChannel* channel, DWORD* transferred) {
+    HANDLE handles[2] = { channel->overlapped.hEvent, channel->process };
+    if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0) return FALSE;
+    return GetOverlappedResult(channel->pipe, &channel->overlapped, transferred, FALSE);
+}
+#endif
+
+// sd_notify(3) without libsystemd: one datagram to $NOTIFY_SOCKET
+static void notifySystemd(const char* message) {
+#ifdef _WIN32
+    (void)message;
+#else
+    const char* socketPath = getenv("NOTIFY_SOCKET");
+    struct sockaddr_un addr;
+    size_t pathLen = socketPath ? strlen(socketPath) : 0;
+    if (pathLen < 2 || pathLen >= sizeof(addr.sun_path) || (socketPath[0] != '/' && socketPath[0] != '@')) return;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, socketPath, pathLen);
+    if (addr.sun_path[0] == '@') addr.sun_path[0] = '\0';  // Abstract namespace
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return;
+    if (sendto(fd, message, strlen(message), MSG_NOSIGNAL, (struct sockaddr*)&addr,
+               (socklen_t)(offsetof(struct sockaddr_un, sun_path) + pathLen)) < 0) {
+        writeLog("WARNING", "sd_notify to %s failed (errno %d)", socketPath, errno);
+    }
+    close(fd);
+#endif
+}
+
+// Block until java signals ready or closes the channel, then log it and
+// optionally tell systemd (ready.notify)
+void waitForReady(ReadyChannel* channel, BOOL notify) {
+    char byte;
+#ifdef _WIN32
+    DWORD transferred = 0;
+    BOOL ok = channel->connected || waitForReadyPipe(channel, &transferred);
+    if (ok) {
+        ResetEvent(channel->overlapped.hEvent);
+        ok = ReadFile(channel->pipe, &byte, 1, NULL, &channel->overlapped) || GetLastError() == ERROR_IO_PENDING;
+    }
+    if (ok && waitForReadyPipe(channel, &transferred) && transferred == 1) {
+        channel->readyMicros = getElapsedMicros();
+    }
+#else
+    // The launcher's copy of the write end would keep the pipe open forever
+    close(channel->writeFd);
+    channel->writeFd = -1;
+
+    ssize_t bytesRead;
+    do {
+        bytesRead = read(channel->readFd, &byte, 1);
+    } while (bytesRead < 0 && errno == EINTR);
+    if (bytesRead == 1) channel->readyMicros = getElapsedMicros();
+#endif
+    closeReadyChannel(channel);
+
+    if (!channel->readyMicros) {
+        writeLog("WARNING", "Java did not signal ready before closing the readiness channel");
+        return;
+    }
+
+    long long javaStartMicros = getJavaStartMicros(channel->readyMicros);
+    writeLog("INFO", "Java signalled ready %.2f ms after it was started (%.2f ms after launcher start)",
+             (channel->readyMicros - javaStartMicros) / 1000.0, channel->readyMicros / 1000.0);
+
+    if (notify) {
+        char message[128];
+        snprintf(message, sizeof(message), "READY=1\nSTATUS=Java ready after %.1f ms",
+                 (channel->readyMicros - javaStartMicros) / 1000.0);
+        notifySystemd(message);
+    }
+}
+
+// Work held back so it does not compete with the JVM's startup (the next spare
+// JVM); run once the app signalled ready, before exec, or when the launch is over
+static void (*g_afterStartup)(void);
+
+void runAfterStartup(void) {
+    void (*task)(void) = g_afterStartup;
+    g_afterStartup = NULL;
+    if (task) task();
+}
+
+// Start the Java process; in console mode wait for it and store its exit code
+// and resource usage (usage->valid stays 0 when the launcher did not wait)
+// ready (NULL = none) is waited on first when java was handed a readiness channel
+// In LAUNCH_MODE_EXEC the launcher image is replaced and this only returns on failure
+// Returns FALSE if the process could not be started (OS error code in *lastError)
+BOOL launchProcess(const char* javaPath, char** childArgv, BOOL hasConsole, int launchMode,
+                   ReadyChannel* ready, BOOL readyNotify, int* exitCode, ChildUsage* usage,
+                   unsigned long* lastError) {
+    long long spawnStart = getElapsedMicros();
+    memset(usage, 0, sizeof(ChildUsage));
+#ifdef _WIN32
+    (void)launchMode; // exec is rejected in main() on Windows
+
+    // CreateProcess takes one string; java.exe's CRT splits it back into childArgv
+    int childArgc = 0;
+    while (childArgv[childArgc]) childArgc++;
+    char* cmdLine = joinArguments(childArgv, childArgc);
+    if (!cmdLine) {
+        *lastError = ERROR_NOT_ENOUGH_MEMORY;
+        return FALSE;
+    }
+
+    // Setup startup info
+    STARTUPINFOA si = {sizeof(si)};
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+
+    if (hasConsole) {
+        // In console mode, explicitly pass the console handles
+        si.dwFlags = STARTF_USESTDHANDLES;
+        si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+        si.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+        si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    }
+
+    // Inherit handles so console I/O works
+    if (!CreateProcessA(NULL, cmdLine, NULL, NULL, TRUE,
+                        0, NULL, NULL, &si, &pi)) {
+        *lastError = GetLastError();
+        return FALSE;
+    }
+
+    recordPhase(PHASE_SPAWN, spawnStart);
+    writeLog("INFO", "Java process started successfully (PID: %lu)", pi.dwProcessId);
+    logPhaseTimings();
+
+    // Config values and the command vector live in the arena and are no longer
+    // needed; free them so the launcher stays small while Java runs
+    arenaRelease();
+    logMemoryUsage();
+
+    // Java is starting; now write what was logged so far
+    flushLog();
+
+    if (hasConsole) {
+        if (ready) {
+            ready->process = pi.hProcess;
+            waitForReady(ready, readyNotify);
+            runAfterStartup();
+            flushLog();
+        }
+
+        // Console mode: Wait for Java process to complete
+        WaitForSingleObject(pi.hProcess, INFINITE);
+
+        DWORD processExitCode = 0;
+        GetExitCodeProcess(pi.hProcess, &processExitCode);
+
+        writeLog("INFO", "Java process exited with code: %lu", processExitCode);
+
+        // FILETIMEs count 100 ns units
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessTimes(pi.hProcess, &creationTime, &exitTime, &kernelTime, &userTime) &&
+            GetProcessMemoryInfo(pi.hProcess, &counters, sizeof(counters))) {
+            usage->valid = 1;
+            usage->wallMicros = getElapsedMicros() - spawnStart;
+            ULARGE_INTEGER user, kernel;
+            user.LowPart = userTime.dwLowDateTime;
+            user.HighPart = userTime.dwHighDateTime;
+            kernel.LowPart = kernelTime.dwLowDateTime;
+            kernel.HighPart = kernelTime.dwHighDateTime;
+            usage->userMicros = (long long)(user.QuadPart / 10);
+            usage->systemMicros = (long long)(kernel.QuadPart / 10);
+            usage->peakRssKB = (long long)(counters.PeakWorkingSetSize / 1024);
+            usage->majorFaults = -1;
+            usage->minorFaults = (long long)counters.PageFaultCount;
+            logChildUsage(usage);
+        }
+
+        CloseHandle(pi.hProcess);
+        CloseHandle(pi.hThread);
+        *exitCode = (int)processExitCode;
+        return TRUE;
+    }
+
+    // GUI mode: Launch and exit immediately
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+
+    writeLog("INFO", "Launched in GUI mode, launcher exiting");
+    *exitCode = 0;
+    return TRUE;
+#else
+    (void)hasConsole; // always waits, see isGuiMode()
+
+    if (launchMode == LAUNCH_MODE_EXEC) {
+        // Java takes over this PID; close the log first, nothing runs after execv
+        writeLog("INFO", "Replacing launcher with Java process (PID: %ld)", (long)getpid());
+        // Nothing runs after execv, so held-back work has to start alongside Java
+        runAfterStartup();
+        logPhaseTimings();
+        closeLog();
+        execv(javaPath, childArgv);
+
+        *lastError = (unsigned long)errno;
+        return FALSE;
+    }
+
+    // glibc/musl posix_spawn uses CLONE_VFORK: no page-table copy of the launcher
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+#ifdef POSIX_SPAWN_USEVFORK
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_USEVFORK);
+#endif
+
+    pid_t pid;
+    int rc = posix_spawn(&pid, javaPath, NULL, &attr, childArgv, environ);
+    posix_spawnattr_destroy(&attr);
+
+    if (rc != 0) {
+        *lastError = (unsigned long)rc;
+        return FALSE;
+    }
+
+    recordPhase(PHASE_SPAWN, spawnStart);
+    writeLog("INFO", "Java process started successfully (PID: %ld)", (long)pid);
+    logPhaseTimings();
+
+    // Config values and the command vector live in the arena and are no longer
+    // needed; free them so the launcher stays small while Java runs
+    arenaRelease();
+    logMemoryUsage();
+
+    // Java is starting; now write what was logged so far
+    flushLog();
+
+    // Terminal Ctrl+C / Ctrl+\ reach the whole process group; let Java decide
+    // how to exit and report that code instead of dying first
+    signal(SIGINT, SIG_IGN);
+    signal(SIGQUIT, SIG_IGN);
+
+    if (ready) {
+        waitForReady(ready, readyNotify);
+        runAfterStartup();
+        flushLog();
+    }
+
+    *exitCode = waitForChild(pid, usage);
+    writeLog("INFO", "Java process exited with code: %d", *exitCode);
+    if (usage->valid) {
+        usage->wallMicros = getElapsedMicros() - spawnStart;
+        logChildUsage(usage);
+    }
+    return TRUE;
+#endif
+}
+
+// Launch-plan cache
+// A plan file per launcher records the resolved launch together with the inputs
+// it was derived from. When every input still matches, main() skips .jrc parsing,
+// the PATH scan, AOT naming and cleanup and goes straight to spawning Java
+
+#define PLAN_MAGIC 0x4E4C504AU     // "JPLN"
+#define PLAN_VERSION 15
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+// Inputs a launch plan depends on (zero-filled before use so it can be memcmp'd)
+typedef struct {
+    FileStamp exeStamp;                            // Launcher binary (upgrades invalidate)
+    FileStamp configStamp;                         // .jrc file, all 0 if absent; same-second edits count
+    unsigned long long pathHash;                   // PATH environment variable
+    unsigned long long argsHash;                   // Arguments after the program name
+    unsigned long long cwdHash;                    // Relative JAR/AOT paths depend on it
+    int hasConsole;                                // java vs javaw
+} LaunchPlanKey;
+
+// On-disk layout: header followed by NUL-terminated javaPath, jarPath, aotPath,
+// logFile, traceFile, metricsDir, cracPath, then the Java, training, create-step
+// and training environment lists (javaArgCount, trainArgCount, ... entries)
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    LaunchPlanKey key;
+    unsigned long long jarSize, jarModTime;        // Validated on load
+    FileStamp jarStamp;                            // Validated on load with aotContentKey
+    unsigned long long javaSize, javaModTime;      // Validated on load
+    int aotMode;
+    int aotTrain;
+    int aotContentKey;
+    int launchMode;
+    int logOverwrite;
+    int logLevel;
+    int logFormat;
+    int journal;
+    int readySignal;
+    int readyNotify;
+    int serverMode;
+    int serverIdle;
+    int singleInstance;
+    int cracMode;
+    int jdkMajor;
+    int trainTimeout;
+    unsigned int javaArgCount;
+    unsigned int trainArgCount;
+    unsigned int createArgCount;
+    unsigned int trainEnvCount;
+    unsigned int stringsSize;
+} LaunchPlanHeader;
+
+// FNV-1a 64-bit hash, continue a running hash by passing it back in
+unsigned long long hashString(const char* str, unsigned long long hash) {
+    for (; str && *str; str++) {
+        hash ^= (unsigned char)*str;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// Per-user state directory: %LOCALAPPDATA%\jr or $XDG_CACHE_HOME/jr (~/.cache/jr)
+// Resolved once per process. Reads only need the path, so it is not created here:
+// writers call createUserCacheDir() or open through openCacheFile().
+// Returns 0 if no suitable location exists
+static char g_userCacheDir[MAX_PATH];
+static int g_userCacheDirState = 0;    // 0 = not resolved yet, 1 = resolved, -1 = none
+
+int getUserCacheDir(char* dir, size_t size) {
+    if (g_userCacheDirState == 0) {
+        int len = -1;
+#ifdef _WIN32
+        const char* base = getenv("LOCALAPPDATA");
+        if (base && *base) len = snprintf(g_userCacheDir, sizeof(g_userCacheDir), "%s\\jr", base);
+#else
+        const char* base = getenv("XDG_CACHE_HOME");
+        const char* home = getenv("HOME");
+        if (base && *base) {
+            len = snprintf(g_userCacheDir, sizeof(g_userCacheDir), "%s/jr", base);
+        } else if (home && *home) {
+            len = snprintf(g_userCacheDir, sizeof(g_userCacheDir), "%s/.cache/jr", home);
+        }
+#endif
+        g_userCacheDirState = len >= 0 && len < (int)sizeof(g_userCacheDir) ? 1 : -1;
+    }
+    if (g_userCacheDirState < 0) return 0;
+    return snprintf(dir, size, "%s", g_userCacheDir) < (int)size;
+}
+
+// Create the cache directory (and its parent, ~/.cache) before writing into it
+int createUserCacheDir(void) {
+    char dir[MAX_PATH];
+    if (!getUserCacheDir(dir, sizeof(dir))) return 0;
+#ifdef _WIN32
+    return CreateDirectoryA(dir, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    char* slash = strrchr(dir, '/');
+    if (slash && slash != dir) {
+        *slash = '\0';
+        mkdir(dir, 0700);
+        *slash = '/';
+    }
+    return mkdir(dir, 0700) == 0 || errno == EEXIST;
+#endif
+}
+
+// fopen() for a file in the cache directory, creating the directory when it is missing
+FILE* openCacheFile(const char* path, const char* mode) {
+    FILE* f = fopen(path, mode);
+    if (!f && errno == ENOENT && createUserCacheDir()) f = fopen(path, mode);
+    return f;
+}
+
+// Write a fixed-size record to the cache directory. Renamed into place so a
+// concurrent launcher, or one after a crash, never reads a partial record
+int writeCacheRecord(const char* path, const void* record, size_t size) {
+    char tempPath[MAX_PATH];
+#ifdef _WIN32
+    int tempLen = snprintf(tempPath, sizeof(tempPath), "%s.%lu.tmp", path, GetCurrentProcessId());
+#else
+    int tempLen = snprintf(tempPath, sizeof(tempPath), "%s.%ld.tmp", path, (long)getpid());
+#endif
+    FILE* f = tempLen < (int)sizeof(tempPath) ? openCacheFile(tempPath, "wb") : NULL;
+    if (!f) return 0;
+
+    int ok = fwrite(record, size, 1, f) == 1;
+    ok = (fclose(f) == 0) && ok;
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tempPath, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(tempPath, path) == 0;
+#endif
+    if (!ok) remove(tempPath);
+    return ok;
+}
+
+// Plan file for this launcher: <cachedir>/<exename>.<exepath-hash>.plan
+int getLaunchPlanPath(const char* exeBaseName, char* planPath, size_t size) {
+    char cacheDir[MAX_PATH];
+    char exePath[MAX_PATH];
+    char hashStr[32];
+
+    if (!getUserCacheDir(cacheDir, sizeof(cacheDir))) return 0;
+
+    getExePath(exePath, sizeof(exePath));
+    encodeBase52(hashString(exePath, FNV_OFFSET_BASIS), hashStr, sizeof(hashStr));
+    return snprintf(planPath, size, "%s" PATH_SEP "%s.%s.plan", cacheDir, exeBaseName, hashStr) < (int)size;
+}
+
+void buildLaunchPlanKey(LaunchPlanKey* key, const char* configPath, int argc, char** argv,
+                        BOOL hasConsole) {
+    char exePath[MAX_PATH];
+    char cwd[MAX_PATH];
+
+    memset(key, 0, sizeof(LaunchPlanKey));
+
+    getExePath(exePath, sizeof(exePath));
+    getFileStamp(exePath, &key->exeStamp);
+    getFileStamp(configPath, &key->configStamp);
+
+    key->pathHash = hashString(getenv("PATH"), FNV_OFFSET_BASIS);
+    // NUL-separated so "a b" and "a" "b" hash differently
+    key->argsHash = FNV_OFFSET_BASIS;
+    for (int i = 1; i < argc; i++) {
+        key->argsHash = hashString(argv[i], key->argsHash) * FNV_PRIME;
+    }
+
+#ifdef _WIN32
+    if (!GetCurrentDirectoryA(sizeof(cwd), cwd)) cwd[0] = '\0';
+#else
+    if (!getcwd(cwd, sizeof(cwd))) cwd[0] = '\0';
+#endif
+    key->cwdHash = hashString(cwd, FNV_OFFSET_BASIS);
+    key->hasConsole = hasConsole ? 1 : 0;
+}
+
+// Copy the next NUL-terminated string out of the mapped strings block
+static const char* readPlanString(const char* pos, const char* end, char* out, size_t outSize) {
+    if (!pos) return NULL;
+    const char* nul = memchr(pos, '\0', end - pos);
+    if (!nul || (size_t)(nul - pos) >= outSize) return NULL;
+    memcpy(out, pos, nul - pos + 1);
+    return nul + 1;
+}
+
+// Validate the mapped plan against the current inputs and copy it out
+static BOOL readLaunchPlan(const char* data, size_t size, const LaunchPlanKey* key, LaunchPlan* plan) {
+    const LaunchPlanHeader* header = (const LaunchPlanHeader*)data;
+    if (size < sizeof(LaunchPlanHeader) ||
+        header->magic != PLAN_MAGIC || header->version != PLAN_VERSION ||
+        header->stringsSize != size - sizeof(LaunchPlanHeader) ||
+        memcmp(&header->key, key, sizeof(LaunchPlanKey)) != 0) {
+        return FALSE;
+    }
+
+    const char* pos = data + sizeof(LaunchPlanHeader);
+    const char* end = data + size;
+    pos = readPlanString(pos, end, plan->javaPath, sizeof(plan->javaPath));
+    pos = readPlanString(pos, end, plan->jarPath, sizeof(plan->jarPath));
+    pos = readPlanString(pos, end, plan->aotPath, sizeof(plan->aotPath));
+    pos = readPlanString(pos, end, plan->logFile, sizeof(plan->logFile));
+    pos = readPlanString(pos, end, plan->traceFile, sizeof(plan->traceFile));
+    pos = readPlanString(pos, end, plan->metricsDir, sizeof(plan->metricsDir));
+    pos = readPlanString(pos, end, plan->cracPath, sizeof(plan->cracPath));
+    if (!pos) return FALSE;
+
+    // Java and JAR must be the same files the plan was built for
+    unsigned long long fileSize, modTime;
+    if (!getFileInfo(plan->javaPath, &fileSize, &modTime) ||
+        fileSize != header->javaSize || modTime != header->javaModTime) {
+        return FALSE;
+    }
+    if (plan->jarPath[0] &&
+        (!getFileInfo(plan->jarPath, &fileSize, &modTime) ||
+         fileSize != header->jarSize || modTime != header->jarModTime)) {
+        return FALSE;
+    }
+    // Content-keyed cache names must follow a rebuild within the same second
+    if (header->aotContentKey) {
+        FileStamp stamp;
+        if (!getFileStamp(plan->jarPath, &stamp) ||
+            memcmp(&stamp, &header->jarStamp, sizeof(FileStamp)) != 0) {
+            return FALSE;
+        }
+    }
+
+    // A cache being created last time must now be used (and vice versa)
+    if (header->aotMode == AOT_MODE_USE && !isRegularFile(plan->aotPath)) return FALSE;
+    if ((header->aotMode == AOT_MODE_CREATE || header->aotTrain) && isRegularFile(plan->aotPath)) return FALSE;
+    if (header->cracMode == CRAC_MODE_RESTORE && !hasCRaCImage(plan->cracPath)) return FALSE;
+    if (header->cracMode == CRAC_MODE_CHECKPOINT && hasCRaCImage(plan->cracPath)) return FALSE;
+
+    // Argument lists go to the arena, the mapping is closed after loading
+    ArgList* lists[] = { &plan->javaArgs, &plan->trainArgs, &plan->createArgs, &plan->trainEnv };
+    unsigned int counts[] = { header->javaArgCount, header->trainArgCount, header->createArgCount,
+                              header->trainEnvCount };
+    for (int l = 0; l < 4; l++) {
+        for (unsigned int i = 0; i < counts[l]; i++) {
+            const char* nul = pos < end ? memchr(pos, '\0', end - pos) : NULL;
+            if (!nul || !argListAdd(lists[l], pos)) {
+                for (int k = 0; k < 4; k++) memset(lists[k], 0, sizeof(ArgList));
+                return FALSE;
+            }
+            pos = nul + 1;
+        }
+    }
+
+    plan->aotMode = header->aotMode;
+    plan->aotTrain = header->aotTrain;
+    plan->aotContentKey = header->aotContentKey;
+    plan->trainTimeout = header->trainTimeout;
+    plan->launchMode = header->launchMode;
+    plan->logOverwrite = header->logOverwrite;
+    plan->logLevel = header->logLevel;
+    plan->logFormat = header->logFormat;
+    plan->journal = header->journal;
+    plan->readySignal = header->readySignal;
+    plan->readyNotify = header->readyNotify;
+    plan->serverMode = header->serverMode;
+    plan->serverIdle = header->serverIdle;
+    plan->singleInstance = header->singleInstance;
+    plan->cracMode = header->cracMode;
+    plan->jdkMajor = header->jdkMajor;
+    return TRUE;
+}
+
+// Memory-map the plan file and load it if all key inputs still match
+BOOL loadLaunchPlan(const char* planPath, const LaunchPlanKey* key, LaunchPlan* plan) {
+    BOOL loaded = FALSE;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(planPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return FALSE;
+
+    DWORD size = GetFileSize(file, NULL);
+    HANDLE mapping = (size != INVALID_FILE_SIZE && size > 0)
+        ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    if (mapping) {
+        const char* data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data) {
+            loaded = readLaunchPlan(data, size, key, plan);
+            UnmapViewOfFile(data);
+        }
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+#else
+    int fd = open(planPath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return FALSE;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            loaded = readLaunchPlan((const char*)data, (size_t)st.st_size, key, plan);
+            munmap(data, (size_t)st.st_size);
+        }
+    }
+    close(fd);
+#endif
+    return loaded;
+}
+
+// Write the plan next to its final name and rename it into place, so a
+// concurrent launcher sees either the old or the new plan, never a partial one
+void saveLaunchPlan(const char* planPath, const LaunchPlanKey* key, const LaunchPlan* plan) {
+    LaunchPlanHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = PLAN_MAGIC;
+    header.version = PLAN_VERSION;
+    header.key = *key;
+    header.aotMode = plan->aotMode;
+    header.aotTrain = plan->aotTrain;
+    header.aotContentKey = plan->aotContentKey;
+    header.trainTimeout = plan->trainTimeout;
+    header.launchMode = plan->launchMode;
+    header.logOverwrite = plan->logOverwrite;
+    header.logLevel = plan->logLevel;
+    header.logFormat = plan->logFormat;
+    header.journal = plan->journal;
+    header.readySignal = plan->readySignal;
+    header.readyNotify = plan->readyNotify;
+    header.serverMode = plan->serverMode;
+    header.serverIdle = plan->serverIdle;
+    header.singleInstance = plan->singleInstance;
+    header.cracMode = plan->cracMode;
+    header.jdkMajor = plan->jdkMajor;
+    header.javaArgCount = (unsigned int)plan->javaArgs.count;
+    header.trainArgCount = (unsigned int)plan->trainArgs.count;
+    header.createArgCount = (unsigned int)plan->createArgs.count;
+    header.trainEnvCount = (unsigned int)plan->trainEnv.count;
+
+    if (!getFileInfo(plan->javaPath, &header.javaSize, &header.javaModTime)) return;
+    if (plan->jarPath[0] && !getFileInfo(plan->jarPath, &header.jarSize, &header.jarModTime)) return;
+    if (plan->aotContentKey && !getFileStamp(plan->jarPath, &header.jarStamp)) return;
+
+    const char* strings[] = { plan->javaPath, plan->jarPath, plan->aotPath, plan->logFile, plan->traceFile,
+                              plan->metricsDir, plan->cracPath };
+    int stringCount = (int)(sizeof(strings) / sizeof(strings[0]));
+    for (int i = 0; i < stringCount; i++) {
+        header.stringsSize += (unsigned int)strlen(strings[i]) + 1;
+    }
+    const ArgList* lists[] = { &plan->javaArgs, &plan->trainArgs, &plan->createArgs, &plan->trainEnv };
+    for (int l = 0; l < 4; l++) {
+        for (int i = 0; i < lists[l]->count; i++) {
+            header.stringsSize += (unsigned int)strlen(lists[l]->items[i]) + 1;
+        }
+    }
+
+    char tempPath[MAX_PATH];
+#ifdef _WIN32
+    int tempLen = snprintf(tempPath, sizeof(tempPath), "%s.%lu.tmp", planPath, GetCurrentProcessId());
+#else
+    int tempLen = snprintf(tempPath, sizeof(tempPath), "%s.%ld.tmp", planPath, (long)getpid());
+#endif
+    if (tempLen >= (int)sizeof(tempPath)) return;
+
+    FILE* f = openCacheFile(tempPath, "wb");
+    if (!f) return;
+
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    for (int i = 0; ok && i < stringCount; i++) {
+        ok = fwrite(strings[i], strlen(strings[i]) + 1, 1, f) == 1;
+    }
+    for (int l = 0; l < 4; l++) {
+        for (int i = 0; ok && i < lists[l]->count; i++) {
+            ok = fwrite(lists[l]->items[i], strlen(lists[l]->items[i]) + 1, 1, f) == 1;
+        }
+    }
+    ok = (fclose(f) == 0) && ok;
+
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tempPath, planPath, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(tempPath, planPath) == 0;
+#endif
+    if (!ok) {
+        remove(tempPath);
+        return;
+    }
+    writeLog("INFO", "Saved launch plan: %s", planPath);
+}
+
+// JAR content key (aot.key=content)
+// Adds what the JAR contains to the per-JAR cache names, next to its size and
+// mtime: an FNV-1a hash over the name, CRC-32 and uncompressed size of every
+// entry in the zip central directory, read from a mapping of the file without
+// inflating anything. A same-size rebuild within the same second, or one with
+// fixed timestamps, then gets a new cache instead of reusing a stale one.
+// The hash is memoized per JAR path, keyed on its full-resolution FileStamp
+
+#define CONTENT_KEY_MAGIC 0x4B434A4AU  // "JJCK"
+#define CONTENT_KEY_VERSION 2
+
+#define ZIP_EOCD_SIG 0x06054b50U
+#define ZIP64_LOCATOR_SIG 0x07064b50U
+#define ZIP64_EOCD_SIG 0x06064b50U
+#define ZIP_CENTRAL_SIG 0x02014b50U
+#define ZIP_EOCD_SIZE 22
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP64_EXTRA_ID 0x0001
+
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    FileStamp stamp;
+    unsigned long long contentHash;
+} ContentKeyRecord;
+
+static unsigned int readLE16(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8);
+}
+
+static unsigned int readLE32(const unsigned char* p) {
+    return readLE16(p) | (readLE16(p + 2) << 16);
+}
+
+static unsigned long long readLE64(const unsigned char* p) {
+    return (unsigned long long)readLE32(p) | ((unsigned long long)readLE32(p + 4) << 32);
+}
+
+static unsigned long long hashBytes(const unsigned char* bytes, size_t length, unsigned long long hash) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// Uncompressed size of a central directory entry. 0xFFFFFFFF means the real size is the
+// first field of its ZIP64 extended information extra field. Returns 0 if that is missing
+static int readZipEntrySize(const unsigned char* entry, unsigned long long* size) {
+    *size = readLE32(entry + 24);
+    if (*size != 0xFFFFFFFFULL) return 1;
+
+    const unsigned char* extra = entry + ZIP_CENTRAL_SIZE + readLE16(entry + 28);
+    const unsigned char* extraEnd = extra + readLE16(entry + 30);
+    while (extraEnd - extra >= 4) {
+        size_t fieldSize = readLE16(extra + 2);
+        if (fieldSize > (size_t)(extraEnd - extra - 4)) return 0;
+        if (readLE16(extra) == ZIP64_EXTRA_ID) {
+            if (fieldSize < 8) return 0;
+            *size = readLE64(extra + 4);
+            return 1;
+        }
+        extra += 4 + fieldSize;
+    }
+    return 0;
+}
+
+// Hash the central directory of the mapped zip. Returns 0 if it is not a zip
+static int hashZipCentralDirectory(const unsigned char* data, size_t size,
+                                   unsigned long long* contentHash, unsigned long long* entryCount) {
+    if (size < ZIP_EOCD_SIZE) return 0;
+
+    // End of central directory record, followed by a comment of up to 64 KB
+    const unsigned char* eocd = NULL;
+    size_t lowest = size > ZIP_EOCD_SIZE + 0xFFFF ? size - ZIP_EOCD_SIZE - 0xFFFF : 0;
+    for (size_t pos = size - ZIP_EOCD_SIZE + 1; pos-- > lowest; ) {
+        if (readLE32(data + pos) == ZIP_EOCD_SIG) {
+            eocd = data + pos;
+            break;
+        }
+    }
+    if (!eocd) return 0;
+
+    unsigned long long entries = readLE16(eocd + 10);
+    unsigned long long cdSize = readLE32(eocd + 12);
+    unsigned long long cdOffset = readLE32(eocd + 16);
+
+    // ZIP64: the real values are in the record the locator before the EOCD points to
+    if (entries == 0xFFFF || cdSize == 0xFFFFFFFFULL || cdOffset == 0xFFFFFFFFULL) {
+        size_t eocdPos = (size_t)(eocd - data);
+        if (eocdPos < 20 || readLE32(eocd - 20) != ZIP64_LOCATOR_SIG) return 0;
+        unsigned long long zip64Pos = readLE64(eocd - 20 + 8);
+        if (size < 56 || zip64Pos > size - 56 || readLE32(data + zip64Pos) != ZIP64_EOCD_SIG) return 0;
+        entries = readLE64(data + zip64Pos + 32);
+        cdSize = readLE64(data + zip64Pos + 40);
+        cdOffset = readLE64(data + zip64Pos + 48);
+    }
+    if (cdOffset > size || cdSize > size - cdOffset) return 0;
+
+    unsigned long long hash = FNV_OFFSET_BASIS;
+    unsigned long long count = 0;
+    const unsigned char* pos = data + cdOffset;
+    const unsigned char* end = pos + cdSize;
+    while ((size_t)(end - pos) >= ZIP_CENTRAL_SIZE && readLE32(pos) == ZIP_CENTRAL_SIG) {
+        size_t nameLen = readLE16(pos + 28);
+        size_t entrySize = ZIP_CENTRAL_SIZE + nameLen + readLE16(pos + 30) + readLE16(pos + 32);
+        if (entrySize > (size_t)(end - pos)) return 0;
+
+        unsigned long long uncompressedSize;
+        unsigned char sizeBytes[8];
+        if (!readZipEntrySize(pos, &uncompressedSize)) return 0;
+        for (int i = 0; i < 8; i++) sizeBytes[i] = (unsigned char)(uncompressedSize >> (8 * i));
+
+        hash = hashBytes(pos + 16, 4, hash);                // CRC-32
+        hash = hashBytes(sizeBytes, sizeof(sizeBytes), hash);  // Uncompressed size
+        hash = hashBytes(pos + ZIP_CENTRAL_SIZE, nameLen, hash) * FNV_PRIME;
+        pos += entrySize;
+        count++;
+    }
+    if (count != entries) return 0;
+
+    *contentHash = hash;
+    *entryCount = count;
+    return 1;
+}
+
+// Map the JAR read-only and hash its central directory
+static int computeJarContentKey(const char* jarPath, unsigned long long* contentHash,
+                                unsigned long long* entryCount) {
+    int hashed = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(jarPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+
+    LARGE_INTEGER size;
+    HANDLE mapping = (GetFileSizeEx(file, &size) && size.QuadPart > 0 && (unsigned long long)size.QuadPart <= SIZE_MAX)
+        ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    if (mapping) {
+        const unsigned char* data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data) {
+            hashed = hashZipCentralDirectory(data, (size_t)size.QuadPart, contentHash, entryCount);
+            UnmapViewOfFile(data);
+        }
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+#else
+    int fd = open(jarPath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            hashed = hashZipCentralDirectory((const unsigned char*)data, (size_t)st.st_size,
+                                             contentHash, entryCount);
+            munmap(data, (size_t)st.st_size);
+        }
+    }
+    close(fd);
+#endif
+    return hashed;
+}
+
+// Content key of the JAR, from the memo while the file is untouched
+// Returns 0 if the JAR cannot be read as a zip
+int getJarContentKey(const char* jarPath, unsigned long long* contentHash) {
+    char cacheDir[MAX_PATH];
+    char keyPath[MAX_PATH];
+    char hashStr[32];
+    ContentKeyRecord record;
+    FileStamp stamp;
+
+    if (!getFileStamp(jarPath, &stamp)) return 0;
+    int haveCache = getUserCacheDir(cacheDir, sizeof(cacheDir));
+    if (haveCache) {
+        encodeBase52(hashString(jarPath, FNV_OFFSET_BASIS), hashStr, sizeof(hashStr));
+        haveCache = snprintf(keyPath, sizeof(keyPath), "%s" PATH_SEP "%s.jarkey",
+                             cacheDir, hashStr) < (int)sizeof(keyPath);
+    }
+
+    if (haveCache) {
+        FILE* f = fopen(keyPath, "rb");
+        if (f) {
+            int hit = fread(&record, sizeof(record), 1, f) == 1 &&
+                      record.magic == CONTENT_KEY_MAGIC && record.version == CONTENT_KEY_VERSION &&
+                      memcmp(&record.stamp, &stamp, sizeof(FileStamp)) == 0;
+            fclose(f);
+            if (hit) {
+                *contentHash = record.contentHash;
+                return 1;
+            }
+        }
+    }
+
+    unsigned long long entryCount = 0;
+    if (!computeJarContentKey(jarPath, contentHash, &entryCount)) {
+        writeLog("WARNING", "Could not read the zip central directory of %s, using size and mtime", jarPath);
+        return 0;
+    }
+    writeLog("INFO", "JAR content key computed over %llu entries", entryCount);
+
+    if (haveCache) {
+        memset(&record, 0, sizeof(record));
+        record.magic = CONTENT_KEY_MAGIC;
+        record.version = CONTENT_KEY_VERSION;
+        record.stamp = stamp;
+        record.contentHash = *contentHash;
+        writeCacheRecord(keyPath, &record, sizeof(record));
+    }
+    return 1;
+}
+
+// Other per-JAR-version caches, named like the AOT cache with their own suffix:
+// <jarname>.<size_base52>.<modtime_base52>.jsa (CDS archive) or .crac (CRaC checkpoint).
+// With contentKey (aot.key=content) the content hash is appended to the version,
+// <jarname>.<size_base52>.<modtime_base52>.<contenthash_base52><suffix>, so rebuilds
+// that keep size and mtime get a new cache too
+void buildCachePath(const char* jarPath, const char* suffix, int contentKey, char* path, size_t pathSize) {
+    char key[120];
+    if (!buildJarVersionKey(jarPath, key, sizeof(key))) {
+        path[0] = '\0';
+        return;
+    }
+
+    unsigned long long contentHash;
+    if (contentKey && getJarContentKey(jarPath, &contentHash)) {
+        char hashStr[32];
+        encodeBase52(contentHash, hashStr, sizeof(hashStr));
+        strcat(key, ".");
+        strcat(key, hashStr);
+    }
+    formatCachePath(jarPath, key, suffix, path, pathSize);
+}
+
+// JDK capability probe
+// Learns the version of the selected Java from <java.home>/release (a plain
+// file read), or from one "java -version" run when the file is missing. The
+// result is cached per java binary, keyed on its FileStamp, so later
+// launches only pay for a stat
+
+#define PROBE_MAGIC 0x4B444A4AU    // "JJDK"
+#define PROBE_VERSION 3
+
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    FileStamp javaStamp;           // The java binary the probe ran against
+    JdkInfo info;
+} JdkProbeRecord;
+
+// Feature release from a version string: "25", "21.0.2", "1.8.0_392" -> 25, 21, 8
+int parseJavaMajor(const char* version) {
+    if (strncmp(version, "1.", 2) == 0) version += 2;
+    return atoi(version);
+}
+
+// Derive capability flags from the feature release
+unsigned int jdkFeaturesForMajor(int major) {
+    unsigned int features = 0;
+    if (major >= 13) features |= JDK_FEATURE_CDS_DYNAMIC;
+    if (major >= 19) features |= JDK_FEATURE_CDS_AUTO;
+    if (major >= 24) features |= JDK_FEATURE_AOT_CACHE;
+    if (major >= 25) features |= JDK_FEATURE_AOT_OUTPUT;
+    return features;
+}
+
+// Read JAVA_VERSION and IMPLEMENTOR from <java.home>/release
+int readJavaReleaseFile(const char* javaHome, JdkInfo* info) {
+    char releasePath[MAX_PATH];
+    if (snprintf(releasePath, sizeof(releasePath), "%s" PATH_SEP "release", javaHome) >= (int)sizeof(releasePath)) {
+        return 0;
+    }
+
+    FILE* f = fopen(releasePath, "r");
+    if (!f) return 0;
+
+    char line[MAX_CONFIG_LINE];
+    while (fgets(line, sizeof(line), f)) {
+        char* eq = strchr(line, '=');
+        if (!eq) continue;
+        *eq = '\0';
+
+        char* value = eq + 1;
+        trim(value);
+        if (*value == '"') {
+            value++;
+            char* endQuote = strchr(value, '"');
+            if (endQuote) *endQuote = '\0';
+        }
+
+        if (strcmp(line, "JAVA_VERSION") == 0) {
+            strncpy(info->version, value, sizeof(info->version) - 1);
+        } else if (strcmp(line, "IMPLEMENTOR") == 0) {
+            strncpy(info->vendor, value, sizeof(info->vendor) - 1);
+        }
+    }
+    fclose(f);
+
+    return info->version[0] != '\0';
+}
+
+// Run "<exe> <arg>" with stdout+stderr captured into out (NUL-terminated)
+// Returns the number of bytes captured, -1 if the process could not be started
+int runAndCapture(const char* exePath, const char* arg, char* out, size_t outSize) {
+    size_t total = 0;
+#ifdef _WIN32
+    SECURITY_ATTRIBUTES sa = { sizeof(sa), NULL, TRUE };
+    HANDLE readPipe, writePipe;
+    if (!CreatePipe(&readPipe, &writePipe, &sa, 0)) return -1;
+    SetHandleInformation(readPipe, HANDLE_FLAG_INHERIT, 0);
+
+    char cmdLine[MAX_PATH * 2];
+    snprintf(cmdLine, sizeof(cmdLine), "\"%s\" %s", exePath, arg);
+
+    STARTUPINFOA si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    si.hStdOutput = writePipe;
+    si.hStdError = writePipe;
+
+    BOOL started = CreateProcessA(NULL, cmdLine, NULL, NULL, TRUE, CREATE_NO_WINDOW,
+                                  NULL, NULL, &si, &pi);
+    CloseHandle(writePipe);
+    if (!started) {
+        CloseHandle(readPipe);
+        return -1;
+    }
+
+    DWORD bytesRead;
+    while (total < outSize - 1 &&
+           ReadFile(readPipe, out + total, (DWORD)(outSize - 1 - total), &bytesRead, NULL) &&
+           bytesRead > 0) {
+        total += bytesRead;
+    }
+    CloseHandle(readPipe);
+    WaitForSingleObject(pi.hProcess, INFINITE);
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+#else
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    posix_spawn_file_actions_addclose(&actions, fds[1]);
+
+    char* childArgv[] = { (char*)exePath, (char*)arg, NULL };
+    pid_t pid;
+    int rc = posix_spawn(&pid, exePath, &actions, NULL, childArgv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (rc != 0) {
+        close(fds[0]);
+        return -1;
+    }
+
+    ssize_t bytesRead;
+    while (total < outSize - 1 &&
+           (bytesRead = read(fds[0], out + total, outSize - 1 - total)) != 0) {
+        if (bytesRead < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        total += (size_t)bytesRead;
+    }
+    close(fds[0]);
+    waitForChild(pid, NULL);
+#endif
+    out[total] = '\0';
+    return (int)total;
+}
+
+// Fallback probe: parse `openjdk version "21.0.2" 2024-01-16` from java -version
+int probeJavaVersionOutput(const char* javaHome, JdkInfo* info) {
+    char javaExe[MAX_PATH];
+    char output[2048];
+    if (snprintf(javaExe, sizeof(javaExe), "%s" PATH_SEP "bin" PATH_SEP JAVA_EXE, javaHome) >= (int)sizeof(javaExe)) {
+        return 0;
+    }
+
+    if (runAndCapture(javaExe, "-version", output, sizeof(output)) <= 0) return 0;
+
+    const char* version = strstr(output, "version \"");
+    if (!version) return 0;
+    version += 9;
+
+    const char* endQuote = strchr(version, '"');
+    size_t len = endQuote ? (size_t)(endQuote - version) : 0;
+    if (len == 0 || len >= sizeof(info->version)) return 0;
+    memcpy(info->version, version, len);
+    info->version[len] = '\0';
+
+    // Runtime name from the second line: "OpenJDK Runtime Environment Temurin-21.0.2+13 (build ...)"
+    const char* secondLine = strchr(output, '\n');
+    if (secondLine) {
+        secondLine++;
+        len = strcspn(secondLine, "(\r\n");
+        if (len >= sizeof(info->vendor)) len = sizeof(info->vendor) - 1;
+        memcpy(info->vendor, secondLine, len);
+        info->vendor[len] = '\0';
+        trim(info->vendor);
+    }
+    return 1;
+}
+
+// Learn version and capabilities of the Java installation behind javaPath
+// Returns 0 if neither the release file nor java -version gave a version
+int probeJdk(const char* javaPath, JdkInfo* info) {
+    char cacheDir[MAX_PATH];
+    char probePath[MAX_PATH];
+    char hashStr[32];
+    JdkProbeRecord record;
+    FileStamp javaStamp;
+
+    memset(info, 0, sizeof(JdkInfo));
+    int haveCache = getFileStamp(javaPath, &javaStamp) && getUserCacheDir(cacheDir, sizeof(cacheDir));
+    if (haveCache) {
+        encodeBase52(hashString(javaPath, FNV_OFFSET_BASIS), hashStr, sizeof(hashStr));
+        haveCache = snprintf(probePath, sizeof(probePath), "%s" PATH_SEP "%s.jdk",
+                             cacheDir, hashStr) < (int)sizeof(probePath);
+    }
+
+    if (haveCache) {
+        FILE* f = fopen(probePath, "rb");
+        if (f) {
+            int hit = fread(&record, sizeof(record), 1, f) == 1 &&
+                      record.magic == PROBE_MAGIC && record.version == PROBE_VERSION &&
+                      memcmp(&record.javaStamp, &javaStamp, sizeof(FileStamp)) == 0;
+            fclose(f);
+            if (hit) {
+                *info = record.info;
+                writeLog("INFO", "JDK probe (cached): %s %s", info->version, info->vendor);
+                return info->major > 0;
+            }
+        }
+    }
+
+    char javaHome[MAX_PATH];
+    int haveJavaHome = getJavaHome(javaPath, javaHome, sizeof(javaHome));
+    if (haveJavaHome) {
+        if (readJavaReleaseFile(javaHome, info)) {
+            writeLog("INFO", "JDK probe (release file): %s %s", info->version, info->vendor);
+        } else if (probeJavaVersionOutput(javaHome, info)) {
+            writeLog("INFO", "JDK probe (java -version): %s %s", info->version, info->vendor);
+        } else {
+            writeLog("WARNING", "Could not determine Java version for %s", javaPath);
+        }
+    }
+
+    info->major = info->version[0] ? parseJavaMajor(info->version) : 0;
+    info->features = jdkFeaturesForMajor(info->major);
+#ifndef _WIN32
+    // CRaC builds (Azul Zulu, BellSoft Liberica) ship CRIU as lib/criu
+    if (haveJavaHome && info->major > 0) {
+        char criuPath[MAX_PATH];
+        if (snprintf(criuPath, sizeof(criuPath), "%s/lib/criu", javaHome) < (int)sizeof(criuPath) &&
+            isRegularFile(criuPath)) {
+            info->features |= JDK_FEATURE_CRAC;
+        }
+    }
+#endif
+
+    if (haveCache) {
+        memset(&record, 0, sizeof(record));
+        record.magic = PROBE_MAGIC;
+        record.version = PROBE_VERSION;
+        record.javaStamp = javaStamp;
+        record.info = *info;
+        writeCacheRecord(probePath, &record, sizeof(record));
+    }
+    return info->major > 0;
+}
+
+// Launch journal
+// Every launch appends one fixed-size record to <cachedir>/launches.journal
+// with a single O_APPEND write, so concurrent launchers never interleave.
+// jr --stats summarizes it. The file is rotated to launches.journal.old when
+// it exceeds JOURNAL_MAX_SIZE; --stats reads both
+
+#define JOURNAL_MAGIC 0x4E524A4AU  // "JJRN"
+#define JOURNAL_VERSION 1
+#define JOURNAL_MAX_SIZE (4 * 1024 * 1024)
+#define JOURNAL_EXIT_UNKNOWN INT_MIN  // exitCode of exec launches, written before java runs
+
+typedef struct {
+    unsigned int magic;
+    unsigned short version;
+    unsigned short aotMode;        // AOT_MODE_*
+    char appName[64];              // Launcher base name
+    unsigned long long jarKey;     // Hash of JAR path, size and mtime (0 = no JAR)
+    long long timestamp;           // Unix time of the launch
+    long long launcherMicros;      // Launcher start until java was started
+    long long exitMicros;          // Launcher start until java exited (0 = not waited for)
+    int exitCode;                  // JOURNAL_EXIT_UNKNOWN when java replaced the launcher (exec)
+    int jdkMajor;                  // Feature release of the selected Java (0 = unknown)
+} JournalRecord;
+
+int getJournalPath(char* path, size_t size) {
+    char cacheDir[MAX_PATH];
+    if (!getUserCacheDir(cacheDir, sizeof(cacheDir))) return 0;
+    return snprintf(path, size, "%s" PATH_SEP "launches.journal", cacheDir) < (int)size;
+}
+
+void appendJournalRecord(const char* exeBaseName, const LaunchPlan* plan, long long launcherMicros,
+                         long long exitMicros, int exitCode) {
+    char journalPath[MAX_PATH];
+    if (!getJournalPath(journalPath, sizeof(journalPath))) return;
+
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.magic = JOURNAL_MAGIC;
+    record.version = JOURNAL_VERSION;
+    record.aotMode = (unsigned short)plan->aotMode;
+    strncpy(record.appName, exeBaseName, sizeof(record.appName) - 1);
+    record.timestamp = (long long)time(NULL);
+    record.launcherMicros = launcherMicros;
+    record.exitMicros = exitMicros;
+    record.exitCode = exitCode;
+    record.jdkMajor = plan->jdkMajor;
+
+    unsigned long long jarSize, jarModTime;
+    if (plan->jarPath[0] && getFileInfo(plan->jarPath, &jarSize, &jarModTime)) {
+        char jarInfo[64];
+        snprintf(jarInfo, sizeof(jarInfo), "|%llu|%llu", jarSize, jarModTime);
+        record.jarKey = hashString(jarInfo, hashString(plan->jarPath, FNV_OFFSET_BASIS));
+    }
+
+#ifdef _WIN32
+    // FILE_APPEND_DATA without FILE_WRITE_DATA makes every write an atomic append
+    HANDLE file = CreateFileA(journalPath, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE && GetLastError() == ERROR_PATH_NOT_FOUND && createUserCacheDir()) {
+        file = CreateFileA(journalPath, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    }
+    if (file == INVALID_HANDLE_VALUE) return;
+
+    DWORD written = 0;
+    WriteFile(file, &record, sizeof(record), &written, NULL);
+    DWORD size = GetFileSize(file, NULL);
+    CloseHandle(file);
+#else
+    int fd = open(journalPath, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0 && errno == ENOENT && createUserCacheDir()) {
+        fd = open(journalPath, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    }
+    if (fd < 0) return;
+
+    ssize_t written = write(fd, &record, sizeof(record));
+    struct stat st;
+    unsigned long long size = fstat(fd, &st) == 0 ? (unsigned long long)st.st_size : 0;
+    close(fd);
+#endif
+    (void)written;
+
+    char oldPath[MAX_PATH];
+    if (size > JOURNAL_MAX_SIZE &&
+        snprintf(oldPath, sizeof(oldPath), "%s.old", journalPath) < (int)sizeof(oldPath)) {
+#ifdef _WIN32
+        MoveFileExA(journalPath, oldPath, MOVEFILE_REPLACE_EXISTING);
+#else
+        rename(journalPath, oldPath);
+#endif
+    }
+}
+
+// Append all valid records of one journal file to *records
+static void readJournalFile(const char* path, JournalRecord** records, size_t* count, size_t* capacity) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return;
+
+    JournalRecord record;
+    while (fread(&record, sizeof(record), 1, f) == 1) {
+        if (record.magic != JOURNAL_MAGIC || record.version != JOURNAL_VERSION) continue;
+        if (*count == *capacity) {
+            size_t newCapacity = *capacity ? *capacity * 2 : 256;
+            JournalRecord* grown = (JournalRecord*)realloc(*records, newCapacity * sizeof(JournalRecord));
+            if (!grown) break;
+            *records = grown;
+            *capacity = newCapacity;
+        }
+        (*records)[(*count)++] = record;
+    }
+    fclose(f);
+}
+
+static int compareLongLong(const void* a, const void* b) {
+    long long x = *(const long long*)a;
+    long long y = *(const long long*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Nearest-rank percentile of sorted values
+static long long percentile(const long long* sorted, size_t count, int pct) {
+    size_t rank = (count * pct + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// One output row: p50/p95/p99 of launcher overhead and end-to-end time
+static int formatStatsRow(char* out, size_t size, const char* app, const char* aot,
+                          const JournalRecord* records, size_t count, int aotMode, long long* values) {
+    size_t launches = 0;
+    size_t waited = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (_stricmp(records[i].appName, app) != 0) continue;
+        if (aotMode >= 0 && records[i].aotMode != aotMode) continue;
+        values[launches++] = records[i].launcherMicros;
+    }
+    if (launches == 0) return 0;
+
+    qsort(values, launches, sizeof(long long), compareLongLong);
+    int len = snprintf(out, size, "%-20s %-7s %6lu  %8.2f %8.2f %8.2f",
+                       app, aot, (unsigned long)launches,
+                       percentile(values, launches, 50) / 1000.0,
+                       percentile(values, launches, 95) / 1000.0,
+                       percentile(values, launches, 99) / 1000.0);
+
+    for (size_t i = 0; i < count; i++) {
+        if (_stricmp(records[i].appName, app) != 0 || records[i].exitMicros <= 0) continue;
+        if (aotMode >= 0 && records[i].aotMode != aotMode) continue;
+        values[waited++] = records[i].exitMicros;
+    }
+    if (waited > 0) {
+        qsort(values, waited, sizeof(long long), compareLongLong);
+        len += snprintf(out + len, size - len, "  %9.1f %9.1f %9.1f\n",
+                        percentile(values, waited, 50) / 1000.0,
+                        percentile(values, waited, 95) / 1000.0,
+                        percentile(values, waited, 99) / 1000.0);
+    } else {
+        len += snprintf(out + len, size - len, "  %9s %9s %9s\n", "-", "-", "-");
+    }
+    return len;
+}
+
+// jr --stats [app]: launcher overhead and end-to-end percentiles per app and AOT mode
+int printLaunchStats(const char* appFilter, BOOL hasConsole) {
+    char journalPath[MAX_PATH];
+    char oldPath[MAX_PATH];
+    JournalRecord* records = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+
+    if (getJournalPath(journalPath, sizeof(journalPath))) {
+        if (snprintf(oldPath, sizeof(oldPath), "%s.old", journalPath) < (int)sizeof(oldPath)) {
+            readJournalFile(oldPath, &records, &count, &capacity);
+        }
+        readJournalFile(journalPath, &records, &count, &capacity);
+    }
+
+    if (count == 0) {
+        showMessage(hasConsole, "Launch Statistics", "No launches recorded yet.", MB_ICONINFORMATION);
+        free(records);
+        return 1;
+    }
+
+    long long* values = (long long*)malloc(count * sizeof(long long));
+    size_t reportSize = 256 + count * 4 * 128;
+    char* report = (char*)malloc(reportSize);
+    if (!values || !report) {
+        free(values);
+        free(report);
+        free(records);
+        return 1;
+    }
+
+    static const char* aotNames[] = { "off", "use", "create" };
+    int rows = 0;
+    int len = snprintf(report, reportSize, "%-20s %-7s %6s  %-26s  %-29s\n%-20s %-7s %6s  %8s %8s %8s  %9s %9s %9s\n",
+                       "", "", "", "Launcher overhead (ms)", "Launch to exit (ms)",
+                       "App", "AOT", "Runs", "p50", "p95", "p99", "p50", "p95", "p99");
+
+    // Apps in order of first appearance
+    for (size_t i = 0; i < count; i++) {
+        const char* app = records[i].appName;
+        if (appFilter && _stricmp(app, appFilter) != 0) continue;
+
+        BOOL seen = FALSE;
+        for (size_t j = 0; j < i && !seen; j++) {
+            seen = _stricmp(records[j].appName, app) == 0;
+        }
+        if (seen) continue;
+
+        rows++;
+        len += formatStatsRow(report + len, reportSize - len, app, "all", records, count, -1, values);
+        for (int mode = AOT_MODE_NONE; mode <= AOT_MODE_CREATE; mode++) {
+            len += formatStatsRow(report + len, reportSize - len, app, aotNames[mode], records, count, mode, values);
+        }
+    }
+
+    if (rows == 0) {
+        char msg[256];
+        snprintf(msg, sizeof(msg), "No launches recorded for %s.", appFilter);
+        showMessage(hasConsole, "Launch Statistics", msg, MB_ICONINFORMATION);
+        free(values);
+        free(report);
+        free(records);
+        return 1;
+    }
+
+    if (hasConsole) {
+        fputs(report, stdout);
     } else {
-        const char* jarEnd = strchr(jarStart, ' ');
-        if (!jarEnd) jarEnd = jarStart + strlen(jarStart);
-        size_t len = jarEnd - jarStart;
-        if (len < jarPathSize) {
-            strncpy(jarPath, jarStart, len);
-            jarPath[len] = '\0';
+        showMessage(hasConsole, "Launch Statistics", report, MB_ICONINFORMATION);
+    }
+
+    free(values);
+    free(report);
+    free(records);
+    return 0;
+}
+
+// Prometheus metrics (metrics.dir)
+// Per-app counters live in <cachedir>/<app>.metrics and are updated under an
+// exclusive file lock after each launch. The same lock covers rewriting
+// <metrics.dir>/jr_<app>.prom, which goes through a temp file and a rename so
+// the node_exporter textfile collector never reads a partial file
+
+#define METRICS_MAGIC 0x5254454DU  // "METR"
+#define METRICS_VERSION 3
+#define METRICS_EXIT_CODES 8       // Distinct exit codes kept, the rest count as "other"
+#define METRICS_BUCKETS 10
+
+// Upper bounds of the launcher overhead histogram in microseconds
+static const long long METRICS_BUCKET_MICROS[METRICS_BUCKETS] = {
+    250, 500, 1000, 2000, 5000, 10000, 25000, 50000, 100000, 250000
+};
+
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long launches;
+    unsigned long long aotLaunches[3];           // Indexed by AOT_MODE_*
+    unsigned long long aotFailures;              // Create runs that left no cache behind
+    unsigned long long aotCleanups;              // Stale AOT cache files removed
+    unsigned long long overheadBuckets[METRICS_BUCKETS + 1];  // Non-cumulative, last = +Inf
+    long long overheadMicrosSum;
+    int exitCodes[METRICS_EXIT_CODES];
+    unsigned long long exitCounts[METRICS_EXIT_CODES];
+    unsigned long long exitOther;
+    long long lastLaunchTime;                    // Unix time
+    // Child resource usage, indexed by AOT_MODE_* (waited-for runs only)
+    unsigned long long usageRuns[3];
+    long long userMicros[3];
+    long long systemMicros[3];
+    long long wallMicros[3];
+    long long peakRssKBSum[3];
+    unsigned long long majorFaults[3];
+    unsigned long long minorFaults[3];
+    // Java started until it signalled ready (ready.signal), indexed by AOT_MODE_*
+    unsigned long long readyRuns[3];
+    long long readyMicros[3];
+} MetricsState;
+
+// Label value with Prometheus escaping (backslash, quote, newline)
+static void writePromLabel(FILE* f, const char* value) {
+    for (; *value; value++) {
+        if (*value == '\\' || *value == '"') {
+            fputc('\\', f);
+            fputc(*value, f);
+        } else if (*value == '\n') {
+            fputs("\\n", f);
+        } else {
+            fputc(*value, f);
+        }
+    }
+}
+
+static void writePromHeader(FILE* f, const char* name, const char* type, const char* help) {
+    fprintf(f, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// One sample line; labels are extra pre-formatted pairs (mode="use") or NULL
+static void writePromSample(FILE* f, const char* name, const char* app, const char* labels, double value) {
+    fprintf(f, "%s{app=\"", name);
+    writePromLabel(f, app);
+    fprintf(f, "\"%s%s} %.15g\n", labels ? "," : "", labels ? labels : "", value);
+}
+
+// Rewrite <metricsDir>/jr_<app>.prom from the counters
+static void writePromFile(const char* metricsDir, const char* app, const MetricsState* state) {
+    char promPath[MAX_PATH];
+    char tempPath[MAX_PATH];
+    char labels[64];
+
+    if (snprintf(promPath, sizeof(promPath), "%s" PATH_SEP "jr_%s.prom", metricsDir, app) >= (int)sizeof(promPath)) {
+        writeLog("WARNING", "Metrics path too long: %s", metricsDir);
+        return;
+    }
+#ifdef _WIN32
+    int tempLen = snprintf(tempPath, sizeof(tempPath), "%s.%lu.tmp", promPath, GetCurrentProcessId());
+#else
+    int tempLen = snprintf(tempPath, sizeof(tempPath), "%s.%ld.tmp", promPath, (long)getpid());
+#endif
+
+    FILE* f = tempLen < (int)sizeof(tempPath) ? fopen(tempPath, "w") : NULL;
+    if (!f) {
+        writeLog("WARNING", "Cannot write metrics file: %s", tempPath);
+        return;
+    }
+
+    static const char* aotNames[] = { "off", "use", "create" };
+
+    writePromHeader(f, "jr_launches_total", "counter", "Java launches started by the launcher");
+    writePromSample(f, "jr_launches_total", app, NULL, (double)state->launches);
+
+    writePromHeader(f, "jr_aot_launches_total", "counter",
+                    "Launches by AOT cache mode (use = cache hit, create = cache miss)");
+    for (int mode = AOT_MODE_NONE; mode <= AOT_MODE_CREATE; mode++) {
+        snprintf(labels, sizeof(labels), "mode=\"%s\"", aotNames[mode]);
+        writePromSample(f, "jr_aot_launches_total", app, labels, (double)state->aotLaunches[mode]);
+    }
+
+    writePromHeader(f, "jr_aot_create_failures_total", "counter",
+                    "AOT cache creation runs that exited without producing the cache");
+    writePromSample(f, "jr_aot_create_failures_total", app, NULL, (double)state->aotFailures);
+
+    writePromHeader(f, "jr_aot_cleanups_total", "counter", "Stale AOT cache files removed");
+    writePromSample(f, "jr_aot_cleanups_total", app, NULL, (double)state->aotCleanups);
+
+    writePromHeader(f, "jr_launcher_overhead_seconds", "histogram",
+                    "Time from launcher start until java was started");
+    unsigned long long cumulative = 0;
+    for (int i = 0; i <= METRICS_BUCKETS; i++) {
+        cumulative += state->overheadBuckets[i];
+        if (i < METRICS_BUCKETS) {
+            snprintf(labels, sizeof(labels), "le=\"%g\"", METRICS_BUCKET_MICROS[i] / 1e6);
+        } else {
+            strcpy(labels, "le=\"+Inf\"");
+        }
+        writePromSample(f, "jr_launcher_overhead_seconds_bucket", app, labels, (double)cumulative);
+    }
+    writePromSample(f, "jr_launcher_overhead_seconds_sum", app, NULL, state->overheadMicrosSum / 1e6);
+    writePromSample(f, "jr_launcher_overhead_seconds_count", app, NULL, (double)cumulative);
+
+    writePromHeader(f, "jr_exit_codes_total", "counter", "Java exit codes of launches the launcher waited for");
+    for (int i = 0; i < METRICS_EXIT_CODES && state->exitCounts[i]; i++) {
+        snprintf(labels, sizeof(labels), "code=\"%d\"", state->exitCodes[i]);
+        writePromSample(f, "jr_exit_codes_total", app, labels, (double)state->exitCounts[i]);
+    }
+    if (state->exitOther) {
+        writePromSample(f, "jr_exit_codes_total", app, "code=\"other\"", (double)state->exitOther);
+    }
+
+    // Resource usage of the java process, per AOT mode so cache and no-cache runs compare directly
+    writePromHeader(f, "jr_java_cpu_seconds_total", "counter", "CPU time used by java");
+    for (int mode = AOT_MODE_NONE; mode <= AOT_MODE_CREATE; mode++) {
+        if (!state->usageRuns[mode]) continue;
+        snprintf(labels, sizeof(labels), "aot=\"%s\",cpu=\"user\"", aotNames[mode]);
+        writePromSample(f, "jr_java_cpu_seconds_total", app, labels, state->userMicros[mode] / 1e6);
+        snprintf(labels, sizeof(labels), "aot=\"%s\",cpu=\"system\"", aotNames[mode]);
+        writePromSample(f, "jr_java_cpu_seconds_total", app, labels, state->systemMicros[mode] / 1e6);
+    }
+
+    writePromHeader(f, "jr_java_page_faults_total", "counter",
+                    "Page faults of java (major = read from disk; Windows reports all faults as minor)");
+    for (int mode = AOT_MODE_NONE; mode <= AOT_MODE_CREATE; mode++) {
+        if (!state->usageRuns[mode]) continue;
+        snprintf(labels, sizeof(labels), "aot=\"%s\",type=\"major\"", aotNames[mode]);
+        writePromSample(f, "jr_java_page_faults_total", app, labels, (double)state->majorFaults[mode]);
+        snprintf(labels, sizeof(labels), "aot=\"%s\",type=\"minor\"", aotNames[mode]);
+        writePromSample(f, "jr_java_page_faults_total", app, labels, (double)state->minorFaults[mode]);
+    }
+
+    writePromHeader(f, "jr_java_peak_rss_bytes", "summary", "Peak resident set size of each java run");
+    for (int mode = AOT_MODE_NONE; mode <= AOT_MODE_CREATE; mode++) {
+        if (!state->usageRuns[mode]) continue;
+        snprintf(labels, sizeof(labels), "aot=\"%s\"", aotNames[mode]);
+        writePromSample(f, "jr_java_peak_rss_bytes_sum", app, labels, state->peakRssKBSum[mode] * 1024.0);
+        writePromSample(f, "jr_java_peak_rss_bytes_count", app, labels, (double)state->usageRuns[mode]);
+    }
+
+    writePromHeader(f, "jr_java_wall_seconds", "summary", "Wall time of each java run, spawn to exit");
+    for (int mode = AOT_MODE_NONE; mode <= AOT_MODE_CREATE; mode++) {
+        if (!state->usageRuns[mode]) continue;
+        snprintf(labels, sizeof(labels), "aot=\"%s\"", aotNames[mode]);
+        writePromSample(f, "jr_java_wall_seconds_sum", app, labels, state->wallMicros[mode] / 1e6);
+        writePromSample(f, "jr_java_wall_seconds_count", app, labels, (double)state->usageRuns[mode]);
+    }
+
+    writePromHeader(f, "jr_java_ready_seconds", "summary", "Time from java start until the app signalled ready");
+    for (int mode = AOT_MODE_NONE; mode <= AOT_MODE_CREATE; mode++) {
+        if (!state->readyRuns[mode]) continue;
+        snprintf(labels, sizeof(labels), "aot=\"%s\"", aotNames[mode]);
+        writePromSample(f, "jr_java_ready_seconds_sum", app, labels, state->readyMicros[mode] / 1e6);
+        writePromSample(f, "jr_java_ready_seconds_count", app, labels, (double)state->readyRuns[mode]);
+    }
+
+    writePromHeader(f, "jr_last_launch_timestamp_seconds", "gauge", "Unix time of the last launch");
+    writePromSample(f, "jr_last_launch_timestamp_seconds", app, NULL, (double)state->lastLaunchTime);
+
+    int ok = !ferror(f);
+    ok = fclose(f) == 0 && ok;
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tempPath, promPath, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(tempPath, promPath) == 0;
+#endif
+    if (!ok) {
+        remove(tempPath);
+        writeLog("WARNING", "Cannot write metrics file: %s", promPath);
+    }
+}
+
+// Count this launch and rewrite the .prom file. exited is FALSE when the
+// launcher did not wait for java (GUI and exec runs); exitCode is unused then.
+// usage is NULL when no child resource usage is available, readyLatencyMicros
+// is -1 when java did not signal ready
+void updateMetrics(const char* metricsDir, const char* exeBaseName, const LaunchPlan* plan,
+                   long long launcherMicros, BOOL exited, int exitCode, const ChildUsage* usage,
+                   long long readyLatencyMicros) {
+    char cacheDir[MAX_PATH];
+    char statePath[MAX_PATH];
+    MetricsState state;
+
+    if (!getUserCacheDir(cacheDir, sizeof(cacheDir))) return;
+    if (snprintf(statePath, sizeof(statePath), "%s" PATH_SEP "%s.metrics",
+                 cacheDir, exeBaseName) >= (int)sizeof(statePath)) {
+        return;
+    }
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(statePath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE && GetLastError() == ERROR_PATH_NOT_FOUND && createUserCacheDir()) {
+        file = CreateFileA(statePath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                           NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    }
+    if (file == INVALID_HANDLE_VALUE) return;
+    OVERLAPPED lockRange;
+    memset(&lockRange, 0, sizeof(lockRange));
+    if (!LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &lockRange)) {
+        CloseHandle(file);
+        return;
+    }
+    DWORD transferred = 0;
+    BOOL haveState = ReadFile(file, &state, sizeof(state), &transferred, NULL) && transferred == sizeof(state);
+#else
+    int fd = open(statePath, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0 && errno == ENOENT && createUserCacheDir()) {
+        fd = open(statePath, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    }
+    if (fd < 0) return;
+    if (lockf(fd, F_LOCK, 0) != 0) {
+        close(fd);
+        return;
+    }
+    int haveState = pread(fd, &state, sizeof(state), 0) == (ssize_t)sizeof(state);
+#endif
+
+    if (!haveState || state.magic != METRICS_MAGIC || state.version != METRICS_VERSION) {
+        memset(&state, 0, sizeof(state));
+        state.magic = METRICS_MAGIC;
+        state.version = METRICS_VERSION;
+    }
+
+    state.launches++;
+    state.aotLaunches[plan->aotMode]++;
+    if (exited && plan->aotMode == AOT_MODE_CREATE && !isRegularFile(plan->aotPath)) {
+        state.aotFailures++;
+    }
+    state.aotCleanups += (unsigned long long)plan->aotCleanups;
+
+    int bucket = 0;
+    while (bucket < METRICS_BUCKETS && launcherMicros > METRICS_BUCKET_MICROS[bucket]) bucket++;
+    state.overheadBuckets[bucket]++;
+    state.overheadMicrosSum += launcherMicros;
+
+    if (exited) {
+        int slot = 0;
+        while (slot < METRICS_EXIT_CODES && state.exitCounts[slot] && state.exitCodes[slot] != exitCode) slot++;
+        if (slot < METRICS_EXIT_CODES) {
+            state.exitCodes[slot] = exitCode;
+            state.exitCounts[slot]++;
+        } else {
+            state.exitOther++;
+        }
+    }
+    state.lastLaunchTime = (long long)time(NULL);
+
+    if (usage && usage->valid) {
+        int mode = plan->aotMode;
+        state.usageRuns[mode]++;
+        state.userMicros[mode] += usage->userMicros;
+        state.systemMicros[mode] += usage->systemMicros;
+        state.wallMicros[mode] += usage->wallMicros;
+        state.peakRssKBSum[mode] += usage->peakRssKB;
+        if (usage->majorFaults > 0) state.majorFaults[mode] += (unsigned long long)usage->majorFaults;
+        state.minorFaults[mode] += (unsigned long long)usage->minorFaults;
+    }
+    if (readyLatencyMicros >= 0) {
+        state.readyRuns[plan->aotMode]++;
+        state.readyMicros[plan->aotMode] += readyLatencyMicros;
+    }
+
+#ifdef _WIN32
+    SetFilePointer(file, 0, NULL, FILE_BEGIN);
+    WriteFile(file, &state, sizeof(state), &transferred, NULL);
+#else
+    ssize_t written = pwrite(fd, &state, sizeof(state), 0);
+    (void)written;
+#endif
+
+    writePromFile(metricsDir, exeBaseName, &state);
+
+#ifdef _WIN32
+    UnlockFileEx(file, 0, MAXDWORD, MAXDWORD, &lockRange);
+    CloseHandle(file);
+#else
+    close(fd);  // Releases the lock
+#endif
+}
+
+// Journal record and metrics for a finished (or handed-off) launch.
+// exitMicros is 0 when the launcher did not wait for java, usage may be NULL,
+// readyMicros is when java signalled ready (0 = no readiness signal)
+void recordLaunch(const char* exeBaseName, const LaunchPlan* plan, long long launcherMicros,
+                  long long exitMicros, int exitCode, const ChildUsage* usage, long long readyMicros) {
+    if (plan->journal) {
+        appendJournalRecord(exeBaseName, plan, launcherMicros, exitMicros, exitCode);
+    }
+    if (plan->metricsDir[0]) {
+        updateMetrics(plan->metricsDir, exeBaseName, plan, launcherMicros, exitMicros > 0, exitCode, usage,
+                      readyMicros > 0 ? readyMicros - launcherMicros : -1);
+    }
+}
+
+// Startup trace (--trace=FILE / trace.file)
+// Writes the launcher phases as Chrome trace-event JSON. When java was waited
+// for, the JVM's own startup phases and class loading are stitched in from an
+// -Xlog file it wrote during the run; JVM uptime 0 is placed at the end of the
+// spawn phase, which is when the new process starts executing java
+
+// -Xlog option for the JVM side of the trace
+void buildTraceXlogArg(const char* jvmLogPath, char* out, size_t size) {
+    snprintf(out, size, "-Xlog:startuptime,class+load:file=\"%s\":uptimenanos,tags", jvmLogPath);
+}
+
+static void writeJsonString(FILE* f, const char* str) {
+    fputc('"', f);
+    for (; *str; str++) {
+        unsigned char c = (unsigned char)*str;
+        if (c == '"' || c == '\\') {
+            fprintf(f, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+// Convert the -Xlog file into trace events on pid 2. Returns the event count
+static int writeJvmTraceEvents(FILE* f, const char* jvmLogPath, long long jvmStartMicros) {
+    FILE* log = fopen(jvmLogPath, "r");
+    if (!log) return 0;
+
+    int events = 0;
+    char line[MAX_CONFIG_LINE];
+    while (fgets(line, sizeof(line), log)) {
+        // "[<uptime>ns][<tags>] <message>", decorations may be space-padded
+        if (line[0] != '[') continue;
+        char* p;
+        long long nanos = strtoll(line + 1, &p, 10);
+        p = strchr(p, ']');
+        if (!p || p[1] != '[') continue;
+
+        char* tags = p + 2;
+        char* tagsEnd = strchr(tags, ']');
+        if (!tagsEnd) continue;
+        *tagsEnd = '\0';
+        trim(tags);
+        char* message = tagsEnd + 1;
+        trim(message);
+
+        long long ts = jvmStartMicros + nanos / 1000;
+        if (strcmp(tags, "startuptime") == 0) {
+            // "Create VM, 0.0345678 secs", logged when the phase ends
+            char* comma = strrchr(message, ',');
+            double secs;
+            if (!comma || sscanf(comma + 1, "%lf", &secs) != 1) continue;
+            *comma = '\0';
+            long long dur = (long long)(secs * 1000000.0);
+
+            fprintf(f, ",\n{\"name\":");
+            writeJsonString(f, message);
+            fprintf(f, ",\"cat\":\"startuptime\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":2,\"tid\":1}",
+                    ts - dur, dur);
+            events++;
+        } else if (strcmp(tags, "class,load") == 0) {
+            // "java.lang.Object source: shared objects file"
+            char* source = strstr(message, " source: ");
+            if (source) {
+                *source = '\0';
+                source += 9;
+            }
+
+            fprintf(f, ",\n{\"name\":");
+            writeJsonString(f, message);
+            fprintf(f, ",\"cat\":\"class+load\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,\"pid\":2,\"tid\":2", ts);
+            if (source) {
+                fprintf(f, ",\"args\":{\"source\":");
+                writeJsonString(f, source);
+                fprintf(f, "}");
+            }
+            fprintf(f, "}");
+            events++;
+        }
+    }
+
+    fclose(log);
+    return events;
+}
+
+// Write the trace file. jvmLogPath is NULL and exitMicros 0 when java was not
+// waited for (exec, GUI mode); launchMicros is used when there was no spawn (jni)
+void writeTrace(const char* tracePath, const char* exeBaseName, const char* jvmLogPath,
+                long long launchMicros, long long exitMicros, int exitCode, long long readyMicros) {
+    FILE* f = fopen(tracePath, "w");
+    if (!f) {
+        writeLog("WARNING", "Could not write trace file: %s", tracePath);
+        return;
+    }
+
+    long long jvmStartMicros = getJavaStartMicros(launchMicros);
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":");
+    writeJsonString(f, exeBaseName);
+    fprintf(f, "}}");
+
+    for (int i = 0; i < g_phaseEventCount; i++) {
+        const PhaseEvent* event = &g_phaseEvents[i];
+        fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"launcher\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":1}",
+                PHASE_NAMES[event->phase], event->startMicros, event->durationMicros);
+    }
+
+    int jvmEvents = 0;
+    if (exitMicros > 0) {
+        fprintf(f, ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"java\"}}");
+        fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":1,\"args\":{\"name\":\"startup\"}}");
+        fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":2,\"args\":{\"name\":\"class loading\"}}");
+        fprintf(f, ",\n{\"name\":\"java\",\"cat\":\"jvm\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":2,\"tid\":1,"
+                   "\"args\":{\"exitCode\":%d}}",
+                jvmStartMicros, exitMicros - jvmStartMicros, exitCode);
+        if (readyMicros > 0) {
+            fprintf(f, ",\n{\"name\":\"time to ready\",\"cat\":\"jvm\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":2,\"tid\":1}",
+                    jvmStartMicros, readyMicros - jvmStartMicros);
+            fprintf(f, ",\n{\"name\":\"ready\",\"cat\":\"jvm\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%lld,\"pid\":2,\"tid\":1}",
+                    readyMicros);
+        }
+        if (jvmLogPath) {
+            jvmEvents = writeJvmTraceEvents(f, jvmLogPath, jvmStartMicros);
+        }
+    }
+
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    writeLog("INFO", "Wrote startup trace: %s (%d launcher phases, %d JVM events)",
+             tracePath, g_phaseEventCount, jvmEvents);
+}
+
+// Warm JVM server (server=true)
+// The first launch of a JAR starts java/jarrunner/JarRunnerServer.java as a
+// detached JVM listening on a Unix domain socket in the cache directory (AF_UNIX
+// on Windows 10+ as well, the JDK cannot serve named pipes). Later launches
+// send argv, environment and working directory over the socket, forward stdin
+// and copy the app's stdout/stderr until the server reports the exit code.
+// The socket name is keyed like the AOT cache (JAR path, size and mtime) plus
+// the Java path and VM arguments; the server exits after server.idle seconds
+// without a client or as soon as its JAR changes.
+// server=spare trades the shared JVM for isolation: the server is started with
+// jarrunner.server.once, takes a single launch and exits with it, so every
+// run gets a fresh JVM that has already finished VM init and opened the AOT
+// cache. The launch that claims the spare starts the next one after its run,
+// a launch that finds none starts it right away
+
+#define SERVER_RAN 0               // App ran in the warm JVM, exit code is valid
+#define SERVER_UNAVAILABLE 1       // Nothing was sent, launch java normally
+#define SERVER_FAILED 2            // Connection lost while the app was running
+#define SERVER_INELIGIBLE 3        // Launch cannot use a warm JVM, launch java normally
+#define SERVER_EXIT_LOCKED 75      // JarRunnerServer: another server owns the socket
+#define SERVER_START_TIMEOUT_MICROS (30 * 1000000LL)
+#define SERVER_BUFFER_SIZE 65536
+
+// Frame types: 1 type byte, 4-byte big-endian payload length, payload
+#define FRAME_ARG 'A'              // Client: one application argument
+#define FRAME_ENV 'E'              // Client: one NAME=value environment entry
+#define FRAME_CWD 'D'              // Client: working directory
+#define FRAME_RUN 'R'              // Client: request complete, run main
+#define FRAME_STDIN '0'            // Client: stdin data
+#define FRAME_STDIN_EOF '.'        // Client: stdin closed
+#define FRAME_STARTED 'S'          // Server: main is about to be called
+#define FRAME_STDOUT '1'           // Server: stdout data
+#define FRAME_STDERR '2'           // Server: stderr data
+#define FRAME_EXIT 'X'             // Server: exit code (4-byte big-endian)
+
+static BOOL sendAll(SOCKET sock, const char* data, size_t size) {
+    while (size > 0) {
+        int sent = send(sock, data, (int)(size > 0x10000000 ? 0x10000000 : size), MSG_NOSIGNAL);
+        if (sent <= 0) {
+#ifndef _WIN32
+            if (sent < 0 && errno == EINTR) continue;
+#endif
+            return FALSE;
+        }
+        data += sent;
+        size -= (size_t)sent;
+    }
+    return TRUE;
+}
+
+static BOOL recvAll(SOCKET sock, char* data, size_t size) {
+    while (size > 0) {
+        int received = recv(sock, data, (int)size, 0);
+        if (received <= 0) {
+#ifndef _WIN32
+            if (received < 0 && errno == EINTR) continue;
+#endif
+            return FALSE;
+        }
+        data += received;
+        size -= (size_t)received;
+    }
+    return TRUE;
+}
+
+static BOOL sendFrame(SOCKET sock, char type, const char* data, size_t size) {
+    unsigned char header[5];
+    header[0] = (unsigned char)type;
+    header[1] = (unsigned char)(size >> 24);
+    header[2] = (unsigned char)(size >> 16);
+    header[3] = (unsigned char)(size >> 8);
+    header[4] = (unsigned char)size;
+    return sendAll(sock, (const char*)header, sizeof(header)) && (size == 0 || sendAll(sock, data, size));
+}
+
+static BOOL sendStringFrame(SOCKET sock, char type, const char* value) {
+    return sendFrame(sock, type, value, strlen(value));
+}
+
+// Index of "-jar" in the plan's Java arguments, -1 if the app is not started from a JAR
+static int findJarOption(const LaunchPlan* plan) {
+    for (int i = 0; i + 1 < plan->javaArgs.count; i++) {
+        if (strcmp(plan->javaArgs.items[i], "-jar") == 0) return i;
+    }
+    return -1;
+}
+
+// AOT_MODE_USE for a flag that opens an AOT cache or CDS archive, AOT_MODE_CREATE for one that
+// writes it (at exit or as a recording), AOT_MODE_NONE for any other argument
+static int getCacheArgMode(const char* arg) {
+    if (strncmp(arg, "-XX:AOTCache=", 13) == 0 || strncmp(arg, "-XX:SharedArchiveFile=", 22) == 0) {
+        return AOT_MODE_USE;
+    }
+    if (strncmp(arg, "-XX:AOTCacheOutput=", 19) == 0 || strncmp(arg, "-XX:ArchiveClassesAtExit=", 25) == 0 ||
+        strncmp(arg, "-XX:AOTMode=", 12) == 0 || strncmp(arg, "-XX:AOTConfiguration=", 21) == 0 ||
+        strcmp(arg, "-XX:+AutoCreateSharedArchive") == 0) {
+        return AOT_MODE_CREATE;
+    }
+    return AOT_MODE_NONE;
+}
+
+// <cachedir>/<exename>.<key>[.spare].sock; the key changes with the JAR, Java and VM arguments
+static int getServerSocketPath(const char* exeBaseName, const LaunchPlan* plan, const char* jarPath,
+                               int jarOption, char* path, size_t size) {
+    char cacheDir[MAX_PATH];
+    char jarKey[MAX_PATH];
+    char hashStr[32];
+
+    if (!getUserCacheDir(cacheDir, sizeof(cacheDir))) return 0;
+    buildAOTCacheName(jarPath, jarKey, sizeof(jarKey));
+    if (!jarKey[0]) return 0;
+
+    unsigned long long hash = hashString(jarKey, hashString(plan->javaPath, FNV_OFFSET_BASIS)) * FNV_PRIME;
+    for (int i = 0; i < jarOption; i++) {
+        // A server started before the cache existed runs without it; that is the same server
+        if (getCacheArgMode(plan->javaArgs.items[i]) != AOT_MODE_NONE) continue;
+        hash = hashString(plan->javaArgs.items[i], hash) * FNV_PRIME;
+    }
+    encodeBase52(hash, hashStr, sizeof(hashStr));
+
+    int len = snprintf(path, size, "%s" PATH_SEP "%s.%s%s.sock", cacheDir, exeBaseName, hashStr,
+                       plan->serverMode == SERVER_MODE_SPARE ? ".spare" : "");
+    return len >= 0 && (size_t)len < size && (size_t)len < sizeof(((struct sockaddr_un*)0)->sun_path);
+}
+
+static SOCKET connectServer(const char* socketPath) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath, sizeof(addr.sun_path) - 1);
+
+#ifdef _WIN32
+    SOCKET sock = socket(AF_UNIX, SOCK_STREAM, 0);
+#else
+    SOCKET sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+#endif
+    if (sock == INVALID_SOCKET) return INVALID_SOCKET;
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        closesocket(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+// Command line of a JarRunnerServer; argv entries point into the struct, the plan and the arena
+typedef struct {
+    char socketArg[MAX_PATH + 32];
+    char idleArg[64];
+    char jarArg[MAX_PATH + 32];
+    char logPath[MAX_PATH];
+    char** argv;
+    int argc;
+    BOOL once;
+} ServerCommand;
+
+// java [vm.args] [aot] <server properties> -cp <jar> jarrunner.JarRunnerServer
+// Servers and spares only open an existing cache: the launch that creates it writes it
+// at exit, and a server writing it too would race that launch for the same file
+static BOOL buildServerCommand(const LaunchPlan* plan, const char* jarPath, int jarOption,
+                               const char* socketPath, BOOL once, ServerCommand* cmd) {
+    snprintf(cmd->socketArg, sizeof(cmd->socketArg), "-Djarrunner.server.socket=%s", socketPath);
+    snprintf(cmd->idleArg, sizeof(cmd->idleArg), "-Djarrunner.server.idle=%d", plan->serverIdle);
+    snprintf(cmd->jarArg, sizeof(cmd->jarArg), "-Djarrunner.server.jar=%s", jarPath);
+    if (snprintf(cmd->logPath, sizeof(cmd->logPath), "%s.log", socketPath) >= (int)sizeof(cmd->logPath)) {
+        return FALSE;
+    }
+    cmd->once = once;
+    // Socket and log go to the cache directory
+    if (!createUserCacheDir()) return FALSE;
+
+    int argc = 0;
+    char** argv = (char**)arenaAlloc((size_t)(jarOption + 9) * sizeof(char*));
+    if (!argv) return FALSE;
+    argv[argc++] = (char*)plan->javaPath;
+    for (int i = 0; i < jarOption; i++) {
+        int cacheMode = getCacheArgMode(plan->javaArgs.items[i]);
+        if (cacheMode == AOT_MODE_CREATE || (cacheMode == AOT_MODE_USE && plan->aotMode == AOT_MODE_CREATE)) {
+            continue;
+        }
+        argv[argc++] = plan->javaArgs.items[i];
+    }
+    argv[argc++] = cmd->socketArg;
+    argv[argc++] = cmd->idleArg;
+    argv[argc++] = cmd->jarArg;
+    if (once) argv[argc++] = "-Djarrunner.server.once=true";
+    argv[argc++] = "-cp";
+    argv[argc++] = (char*)jarPath;
+    argv[argc++] = "jarrunner.JarRunnerServer";
+    argv[argc] = NULL;
+    cmd->argv = argv;
+    cmd->argc = argc;
+    return TRUE;
+}
+
+// Start a detached JarRunnerServer, output goes to <socket>.log
+#ifdef _WIN32
+static HANDLE spawnServer(const ServerCommand* cmd) {
+    char* cmdLine = joinArguments(cmd->argv, cmd->argc);
+    if (!cmdLine) return NULL;
+
+    SECURITY_ATTRIBUTES inherit = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+    HANDLE logFile = CreateFileA(cmd->logPath, GENERIC_WRITE, FILE_SHARE_READ, &inherit,
+                                 CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    HANDLE nul = CreateFileA("NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, &inherit,
+                             OPEN_EXISTING, 0, NULL);
+
+    STARTUPINFOA si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = nul;
+    si.hStdOutput = logFile;
+    si.hStdError = logFile;
+
+    // Own process group and no console: Ctrl+C in the client's console must not reach it
+    BOOL started = CreateProcessA(NULL, cmdLine, NULL, NULL, TRUE,
+                                  CREATE_NO_WINDOW | CREATE_NEW_PROCESS_GROUP, NULL, NULL, &si, &pi);
+    if (logFile != INVALID_HANDLE_VALUE) CloseHandle(logFile);
+    if (nul != INVALID_HANDLE_VALUE) CloseHandle(nul);
+    if (!started) return NULL;
+
+    CloseHandle(pi.hThread);
+    writeLog("INFO", "Started %s (PID: %lu), log: %s", cmd->once ? "spare JVM" : "warm JVM server",
+             pi.dwProcessId, cmd->logPath);
+    return pi.hProcess;
+}
+#else
+static pid_t spawnServer(const ServerCommand* cmd) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, cmd->logPath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+
+    // New session: terminal signals for the client's process group must not reach it
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+#ifdef POSIX_SPAWN_SETSID
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+#endif
+
+    pid_t pid;
+    int rc = posix_spawn(&pid, cmd->argv[0], &actions, &attr, cmd->argv, environ);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    if (rc != 0) return 0;
+
+    writeLog("INFO", "Started %s (PID: %ld), log: %s", cmd->once ? "spare JVM" : "warm JVM server",
+             (long)pid, cmd->logPath);
+    return pid;
+}
+#endif
+
+#ifdef _WIN32
+static HANDLE startServer(const LaunchPlan* plan, const char* jarPath, int jarOption,
+                          const char* socketPath, BOOL once) {
+#else
+static pid_t startServer(const LaunchPlan* plan, const char* jarPath, int jarOption,
+                         const char* socketPath, BOOL once) {
+#endif
+    ServerCommand cmd;
+    if (!buildServerCommand(plan, jarPath, jarOption, socketPath, once, &cmd)) return 0;
+    return spawnServer(&cmd);
+}
+
+// Connect to the server for this JAR, starting it if needed. Returns
+// INVALID_SOCKET if it could not be reached within SERVER_START_TIMEOUT_MICROS
+static SOCKET connectOrStartServer(const LaunchPlan* plan, const char* jarPath, int jarOption,
+                                   const char* socketPath) {
+    SOCKET sock = connectServer(socketPath);
+    if (sock != INVALID_SOCKET) {
+        writeLog("INFO", "Connected to warm JVM server: %s", socketPath);
+        return sock;
+    }
+
+#ifdef _WIN32
+    HANDLE server = startServer(plan, jarPath, jarOption, socketPath, FALSE);
+#else
+    pid_t server = startServer(plan, jarPath, jarOption, socketPath, FALSE);
+#endif
+    if (!server) {
+        writeLog("WARNING", "Could not start the warm JVM server");
+        return INVALID_SOCKET;
+    }
+
+    BOOL serverRunning = TRUE;
+    long long deadline = getElapsedMicros() + SERVER_START_TIMEOUT_MICROS;
+    while (getElapsedMicros() < deadline) {
+        sock = connectServer(socketPath);
+        if (sock != INVALID_SOCKET) break;
+
+        // A server that lost the start race to another launcher's exits with
+        // SERVER_EXIT_LOCKED; keep waiting for the winner. Anything else is fatal
+        if (serverRunning) {
+            int serverExit = -1;
+#ifdef _WIN32
+            DWORD code;
+            if (WaitForSingleObject(server, 0) == WAIT_OBJECT_0 && GetExitCodeProcess(server, &code)) {
+                serverExit = (int)code;
+            }
+#else
+            int status;
+            if (waitpid(server, &status, WNOHANG) == server) {
+                serverExit = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+            }
+#endif
+            if (serverExit == SERVER_EXIT_LOCKED) {
+                serverRunning = FALSE;
+            } else if (serverExit >= 0) {
+                writeLog("WARNING", "Warm JVM server exited during startup with code %d, see %s.log",
+                         serverExit, socketPath);
+                break;
+            }
+        }
+#ifdef _WIN32
+        Sleep(10);
+#else
+        usleep(10000);
+#endif
+    }
+#ifdef _WIN32
+    CloseHandle(server);
+#endif
+
+    if (sock != INVALID_SOCKET) {
+        writeLog("INFO", "Connected to new warm JVM server: %s", socketPath);
+    }
+    return sock;
+}
+
+#ifdef _WIN32
+// Windows has no poll() for console handles: stdin is copied by its own thread
+static DWORD WINAPI forwardStdinThread(LPVOID param) {
+    SOCKET sock = (SOCKET)(ULONG_PTR)param;
+    static char buffer[SERVER_BUFFER_SIZE];
+    HANDLE input = GetStdHandle(STD_INPUT_HANDLE);
+    DWORD bytesRead;
+    while (ReadFile(input, buffer, sizeof(buffer), &bytesRead, NULL) && bytesRead > 0) {
+        if (!sendFrame(sock, FRAME_STDIN, buffer, bytesRead)) return 0;
+    }
+    sendFrame(sock, FRAME_STDIN_EOF, NULL, 0);
+    return 0;
+}
+#endif
+
+// Read one server frame into buffer; returns the type, 0 on a lost connection
+static int readServerFrame(SOCKET sock, char* buffer, size_t bufferSize, size_t* size) {
+    unsigned char header[5];
+    if (!recvAll(sock, (char*)header, sizeof(header))) return 0;
+    *size = (size_t)header[1] << 24 | (size_t)header[2] << 16 | (size_t)header[3] << 8 | header[4];
+    if (*size > bufferSize || !recvAll(sock, buffer, *size)) return 0;
+    return header[0];
+}
+
+static void writeOutput(int fd, const char* data, size_t size) {
+#ifdef _WIN32
+    DWORD written;
+    WriteFile(GetStdHandle(fd == 1 ? STD_OUTPUT_HANDLE : STD_ERROR_HANDLE), data, (DWORD)size, &written, NULL);
+#else
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return;
+        data += written;
+        size -= (size_t)written;
+    }
+#endif
+}
+
+// Send the request and relay stdio until the exit frame. A server that goes
+// away before FRAME_STARTED (idle shutdown racing the connect) has not run
+// anything, so the launch can still fall back to java
+static int runServerSession(SOCKET sock, const LaunchPlan* plan, int jarOption, int* exitCode) {
+    char cwd[MAX_PATH];
+    BOOL ok = TRUE;
+
+    for (int i = jarOption + 2; ok && i < plan->javaArgs.count; i++) {
+        ok = sendStringFrame(sock, FRAME_ARG, plan->javaArgs.items[i]);
+    }
+#ifdef _WIN32
+    char* environment = GetEnvironmentStringsA();
+    for (const char* entry = environment; ok && entry && *entry; entry += strlen(entry) + 1) {
+        if (*entry != '=') ok = sendStringFrame(sock, FRAME_ENV, entry);  // Skip per-drive "=C:" entries
+    }
+    if (environment) FreeEnvironmentStringsA(environment);
+    if (!GetCurrentDirectoryA(sizeof(cwd), cwd)) cwd[0] = '\0';
+#else
+    for (char** entry = environ; ok && *entry; entry++) {
+        ok = sendStringFrame(sock, FRAME_ENV, *entry);
+    }
+    if (!getcwd(cwd, sizeof(cwd))) cwd[0] = '\0';
+#endif
+    if (ok) ok = sendStringFrame(sock, FRAME_CWD, cwd);
+    if (ok) ok = sendFrame(sock, FRAME_RUN, NULL, 0);
+    if (!ok) return SERVER_UNAVAILABLE;
+
+    // stdin is only consumed once the app runs, a fallback launch still gets all of it
+    static char buffer[SERVER_BUFFER_SIZE];
+    size_t size;
+    BOOL started = FALSE;
+#ifdef _WIN32
+    for (;;) {
+        int type = readServerFrame(sock, buffer, sizeof(buffer), &size);
+        if (type == FRAME_STARTED && !started) {
+            started = TRUE;
+            HANDLE stdinThread = CreateThread(NULL, 0, forwardStdinThread, (LPVOID)(ULONG_PTR)sock, 0, NULL);
+            if (stdinThread) CloseHandle(stdinThread);
+        }
+#else
+    struct pollfd fds[2];
+    fds[0].fd = sock;
+    fds[0].events = POLLIN;
+    fds[1].fd = STDIN_FILENO;
+    fds[1].events = POLLIN;
+    nfds_t pollCount = 1;
+
+    for (;;) {
+        if (poll(fds, pollCount, -1) < 0) {
+            if (errno == EINTR) continue;
+            return started ? SERVER_FAILED : SERVER_UNAVAILABLE;
+        }
+        if (pollCount == 2 && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+            ssize_t bytesRead = read(STDIN_FILENO, buffer, sizeof(buffer));
+            if (bytesRead > 0) {
+                if (!sendFrame(sock, FRAME_STDIN, buffer, (size_t)bytesRead)) return SERVER_FAILED;
+            } else if (bytesRead == 0 || errno != EINTR) {
+                sendFrame(sock, FRAME_STDIN_EOF, NULL, 0);
+                pollCount = 1;
+            }
+        }
+        if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+        int type = readServerFrame(sock, buffer, sizeof(buffer), &size);
+        if (type == FRAME_STARTED && !started) {
+            started = TRUE;
+            pollCount = 2;
+        }
+#endif
+        if (type == FRAME_STDOUT) {
+            writeOutput(1, buffer, size);
+        } else if (type == FRAME_STDERR) {
+            writeOutput(2, buffer, size);
+        } else if (type == FRAME_EXIT && size == 4) {
+            const unsigned char* code = (const unsigned char*)buffer;
+            *exitCode = (int)((unsigned int)code[0] << 24 | (unsigned int)code[1] << 16 |
+                              (unsigned int)code[2] << 8 | code[3]);
+            return SERVER_RAN;
+        } else if (type == 0) {
+            return started ? SERVER_FAILED : SERVER_UNAVAILABLE;
+        }
+    }
+}
+
+// -jar position, absolute JAR path and socket of the plan's warm JVM; FALSE
+// (with the reason logged) if the launch cannot use one
+static BOOL getServerTarget(const char* exeBaseName, const LaunchPlan* plan, int* jarOption,
+                            char* jarPath, char* socketPath) {
+    *jarOption = findJarOption(plan);
+    if (*jarOption < 0) {
+        writeLog("WARNING", "server=true|spare needs a -jar launch, launching java directly");
+        return FALSE;
+    }
+    if (plan->jdkMajor > 0 && plan->jdkMajor < 16) {
+        writeLog("WARNING", "server=true|spare needs Java 16+ (Unix domain sockets), launching java directly");
+        return FALSE;
+    }
+
+    // The JVM is shared by every working directory, so it gets an absolute JAR path
+    const char* jar = plan->javaArgs.items[*jarOption + 1];
+#ifdef _WIN32
+    if (!GetFullPathNameA(jar, MAX_PATH, jarPath, NULL)) return FALSE;
+#else
+    if (!realpath(jar, jarPath)) return FALSE;
+#endif
+    if (!getServerSocketPath(exeBaseName, plan, jarPath, *jarOption, socketPath, MAX_PATH)) {
+        writeLog("WARNING", "No usable socket path for the warm JVM, launching java directly");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Start the spare JVM for the next launch (server=spare) without waiting for it.
+// If one is already listening the new JVM finds its lock taken and exits
+void startSpareServer(const char* exeBaseName, const LaunchPlan* plan) {
+    int jarOption;
+    char jarPath[MAX_PATH];
+    char socketPath[MAX_PATH];
+    if (!getServerTarget(exeBaseName, plan, &jarOption, jarPath, socketPath)) return;
+
+#ifdef _WIN32
+    HANDLE spare = startServer(plan, jarPath, jarOption, socketPath, TRUE);
+    if (spare) CloseHandle(spare);
+#else
+    pid_t spare = startServer(plan, jarPath, jarOption, socketPath, TRUE);
+#endif
+    if (!spare) writeLog("WARNING", "Could not start a spare JVM");
+}
+
+// Spare JVM held back while a cold launch starts (server=spare, no spare claimed).
+// The command is copied out of the arena, which launchProcess() releases
+static ServerCommand g_pendingSpare;
+
+// Start the held-back spare (runAfterStartup)
+static void startPendingSpare(void) {
+#ifdef _WIN32
+    HANDLE spare = spawnServer(&g_pendingSpare);
+    if (spare) CloseHandle(spare);
+#else
+    pid_t spare = spawnServer(&g_pendingSpare);
+#endif
+    if (!spare) writeLog("WARNING", "Could not start a spare JVM");
+
+    for (int i = 0; i < g_pendingSpare.argc; i++) free(g_pendingSpare.argv[i]);
+    free(g_pendingSpare.argv);
+    g_pendingSpare.argv = NULL;
+}
+
+// Hold the spare back instead of competing with the cold launch for CPU
+void deferSpareServer(const char* exeBaseName, const LaunchPlan* plan) {
+    int jarOption;
+    char jarPath[MAX_PATH];
+    char socketPath[MAX_PATH];
+    if (!getServerTarget(exeBaseName, plan, &jarOption, jarPath, socketPath)) return;
+    if (!buildServerCommand(plan, jarPath, jarOption, socketPath, TRUE, &g_pendingSpare)) return;
+
+    char** argv = (char**)malloc((size_t)(g_pendingSpare.argc + 1) * sizeof(char*));
+    if (!argv) return;
+    for (int i = 0; i < g_pendingSpare.argc; i++) {
+        argv[i] = strdup(g_pendingSpare.argv[i]);
+        if (!argv[i]) {
+            while (i-- > 0) free(argv[i]);
+            free(argv);
             return;
         }
     }
-
-    jarPath[0] = '\0';
+    argv[g_pendingSpare.argc] = NULL;
+    g_pendingSpare.argv = argv;
+    g_afterStartup = startPendingSpare;
 }
 
-int main(int argc, char** argv) {
-    char javaPath[MAX_PATH] = {0};
-    char exeBaseName[MAX_PATH] = {0};
-    char configPath[MAX_PATH] = {0};
-    LauncherConfig config;
-    int useConfig = 0;
+// Run the plan's JAR in a warm JVM: the shared server (server=true, started
+// if needed) or a spare (server=spare, used only if one is ready).
+// *requestMicros is when the request was sent (the counterpart of starting java)
+int runOnServer(const char* exeBaseName, const LaunchPlan* plan, int* exitCode, long long* requestMicros) {
+    int jarOption;
+    char jarPath[MAX_PATH];
+    char socketPath[MAX_PATH];
+    if (!getServerTarget(exeBaseName, plan, &jarOption, jarPath, socketPath)) return SERVER_INELIGIBLE;
+
+    // Warm JVMs never write the cache, so the launch that creates it runs java directly
+    if (plan->aotMode == AOT_MODE_CREATE) {
+        writeLog("INFO", "AOT cache is created by a direct launch first: %s", plan->aotPath);
+        return SERVER_UNAVAILABLE;
+    }
 
-    // Initialize high-resolution timer
-    initTimer();
-    long long startTimeMicros = getElapsedMicros();
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) return SERVER_UNAVAILABLE;
+#endif
 
-    // Get executable base name (without .exe) - for display purposes
-    getExeBaseName(exeBaseName, sizeof(exeBaseName));
+    // Waiting for a spare to start would be slower than launching java
+    long long phaseStart = getElapsedMicros();
+    SOCKET sock;
+    if (plan->serverMode == SERVER_MODE_SPARE) {
+        sock = connectServer(socketPath);
+        writeLog("INFO", sock != INVALID_SOCKET ? "Claimed spare JVM: %s" : "No spare JVM ready: %s", socketPath);
+    } else {
+        sock = connectOrStartServer(plan, jarPath, jarOption, socketPath);
+    }
+    recordPhase(PHASE_SERVER, phaseStart);
+    if (sock == INVALID_SOCKET) return SERVER_UNAVAILABLE;
+
+    *requestMicros = getElapsedMicros();
+    logPhaseTimings();
+    flushLog();
+
+    int result = runServerSession(sock, plan, jarOption, exitCode);
+    closesocket(sock);
+    if (result == SERVER_RAN) {
+        writeLog("INFO", "Warm JVM run exited with code: %d", *exitCode);
+    } else if (result == SERVER_UNAVAILABLE) {
+        writeLog("WARNING", "Warm JVM server closed the connection before running the app");
+    } else if (result == SERVER_FAILED) {
+        writeLog("ERROR", "Lost the warm JVM server connection while the app was running");
+        *exitCode = 1;
+    }
+    return result;
+}
 
-    // Build config file path - use full path so it works from any directory
-    getExeFullPathWithoutExt(configPath, sizeof(configPath));
-    strncat(configPath, ".jrc", sizeof(configPath) - strlen(configPath) - 1);
+// Single instance (single.instance=true)
+// The app opts in through jarrunner.JarRunnerInstance (java/jarrunner), which
+// listens on the socket passed as -Djarrunner.instance.socket. A later launch
+// that reaches the listener sends its command-line arguments and working
+// directory in the warm-JVM framing instead of starting java, and exits with
+// the code the app acknowledges them with. The socket is keyed by the .jrc
+// path, not the JAR, so a rebuilt JAR still reaches the running instance; the
+// cache directory makes it per user
+
+#define INSTANCE_ACK_TIMEOUT_MS 5000
+
+// <cachedir>/<exename>.<key>.instance.sock
+int getInstanceSocketPath(const char* exeBaseName, const char* configPath, char* path, size_t size) {
+    char cacheDir[MAX_PATH];
+    char hashStr[32];
+
+    if (!getUserCacheDir(cacheDir, sizeof(cacheDir))) return 0;
+    encodeBase52(hashString(configPath, FNV_OFFSET_BASIS), hashStr, sizeof(hashStr));
+    int len = snprintf(path, size, "%s" PATH_SEP "%s.%s.instance.sock", cacheDir, exeBaseName, hashStr);
+    return len >= 0 && (size_t)len < size && (size_t)len < sizeof(((struct sockaddr_un*)0)->sun_path);
+}
 
-    // Try to load config file
-    useConfig = parseConfigFile(configPath, &config);
+// Hand this launch to the running instance. FALSE if there is none or it did
+// not acknowledge, in which case java is launched as usual
+BOOL forwardToInstance(const char* socketPath, char** args, int argCount, int* exitCode) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) return FALSE;
+#endif
+    SOCKET sock = connectServer(socketPath);
+    if (sock == INVALID_SOCKET) return FALSE;
 
-    // Initialize logging if configured
-    if (useConfig && config.logFile[0]) {
-        initLog(config.logFile, config.logOverwrite);
-        writeLog("INFO", "Launcher started: %s.exe", exeBaseName);
-    }
+    char cwd[MAX_PATH];
+#ifdef _WIN32
+    if (!GetCurrentDirectoryA(sizeof(cwd), cwd)) cwd[0] = '\0';
+    DWORD timeout = INSTANCE_ACK_TIMEOUT_MS;
+#else
+    if (!getcwd(cwd, sizeof(cwd))) cwd[0] = '\0';
+    struct timeval timeout = { INSTANCE_ACK_TIMEOUT_MS / 1000, 0 };
+#endif
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
 
-    // Detect if we're in GUI mode (double-clicked) or console mode (terminal)
-    BOOL guiMode = isGuiMode();
-    BOOL hasConsole = !guiMode;
-    const char* javaExeName = hasConsole ? "java.exe" : "javaw.exe";
+    BOOL ok = TRUE;
+    for (int i = 0; ok && i < argCount; i++) {
+        ok = sendStringFrame(sock, FRAME_ARG, args[i]);
+    }
+    if (ok) ok = sendStringFrame(sock, FRAME_CWD, cwd);
+    if (ok) ok = sendFrame(sock, FRAME_RUN, NULL, 0);
+
+    char ack[4];
+    size_t size = 0;
+    ok = ok && readServerFrame(sock, ack, sizeof(ack), &size) == FRAME_EXIT && size == 4;
+    closesocket(sock);
+    if (!ok) {
+        writeLog("WARNING", "Running instance did not accept the launch: %s", socketPath);
+        return FALSE;
+    }
 
-    writeLog("INFO", "Execution mode: %s", hasConsole ? "Console" : "GUI");
-    writeLog("INFO", "Java executable: %s", javaExeName);
+    const unsigned char* code = (const unsigned char*)ack;
+    *exitCode = (int)((unsigned int)code[0] << 24 | (unsigned int)code[1] << 16 |
+                      (unsigned int)code[2] << 8 | code[3]);
+    return TRUE;
+}
 
-    // Get full command line
-    LPSTR fullCmdLine = GetCommandLineA();
+// Background AOT training (aot.background=true, aot.train.args)
+// A cache miss no longer slows the user's launch: it runs without the cache while a
+// detached, low-priority training run creates it. The launcher starts itself as the
+// run's supervisor (--aot-train), which runs the workload (plan->trainArgs) for at
+// most aot.train.timeout seconds and then, for a recorded workload, the create step
+// (plan->createArgs). <cache>.lock, next to the cache being created, stays held by
+// the supervisor and its JVMs, so racing launches start at most one training per
+// JAR version, whichever launcher they come from
+
+#define TRAIN_STOP_GRACE_SECONDS 60    // After the stop request, for the JVM to write its AOT data
+
+// Run one training step with the supervisor's stdio (the training log). A step
+// that overruns timeoutSeconds (0 = no limit) is asked to exit, so the JVM still
+// writes its AOT data on the way out, and killed TRAIN_STOP_GRACE_SECONDS later
+static int runTrainingStep(char** stepArgv, int stepArgc, int timeoutSeconds) {
+#ifdef _WIN32
+    char* cmdLine = joinArguments(stepArgv, stepArgc);
+    STARTUPINFOA si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    si.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+    si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    if (!cmdLine || !CreateProcessA(NULL, cmdLine, NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi)) {
+        fprintf(stderr, "jr: could not start %s (error %lu)\n", stepArgv[0], GetLastError());
+        return -1;
+    }
+    CloseHandle(pi.hThread);
+
+    // A windowless JVM gets no console event, so a timeout ends it without its AOT data
+    DWORD wait = timeoutSeconds > 0 ? (DWORD)timeoutSeconds * 1000 : INFINITE;
+    if (WaitForSingleObject(pi.hProcess, wait) == WAIT_TIMEOUT) {
+        fprintf(stderr, "jr: stopping the training run after %d s\n", timeoutSeconds);
+        TerminateProcess(pi.hProcess, 1);
+        WaitForSingleObject(pi.hProcess, INFINITE);
+    }
+    DWORD code = 1;
+    GetExitCodeProcess(pi.hProcess, &code);
+    CloseHandle(pi.hProcess);
+    return (int)code;
+#else
+    (void)stepArgc; // stepArgv is NULL-terminated
+    pid_t pid;
+    int rc = posix_spawn(&pid, stepArgv[0], NULL, NULL, stepArgv, environ);
+    if (rc != 0) {
+        fprintf(stderr, "jr: could not start %s (error %d)\n", stepArgv[0], rc);
+        return -1;
+    }
 
-    // Check for --create-config flag
-    if (strstr(fullCmdLine, "--create-config")) {
-        // Extract JAR path if provided
-        char jarPath[MAX_PATH] = {0};
-        char* jarArg = strstr(fullCmdLine, "--create-config");
-        jarArg += 15; // Skip "--create-config"
-        while (*jarArg == ' ') jarArg++;
-
-        if (*jarArg && *jarArg != '-') {
-            // JAR path provided
-            if (*jarArg == '"') {
-                jarArg++;
-                char* endQuote = strchr(jarArg, '"');
-                if (endQuote) {
-                    size_t len = endQuote - jarArg;
-                    if (len < sizeof(jarPath)) {
-                        strncpy(jarPath, jarArg, len);
-                        jarPath[len] = '\0';
-                    }
-                }
+    long long deadline = timeoutSeconds > 0 ? getElapsedMicros() + timeoutSeconds * 1000000LL : 0;
+    BOOL stopping = FALSE;
+    int status = 0;
+    for (;;) {
+        pid_t done = waitpid(pid, &status, deadline ? WNOHANG : 0);
+        if (done == pid) break;
+        if (done < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (done == 0 && getElapsedMicros() >= deadline) {
+            if (!stopping) {
+                fprintf(stderr, "jr: stopping the training run after %d s\n", timeoutSeconds);
+                kill(pid, SIGTERM);
+                stopping = TRUE;
+                deadline += TRAIN_STOP_GRACE_SECONDS * 1000000LL;
             } else {
-                char* end = strchr(jarArg, ' ');
-                if (!end) end = jarArg + strlen(jarArg);
-                size_t len = end - jarArg;
-                if (len < sizeof(jarPath)) {
-                    strncpy(jarPath, jarArg, len);
-                    jarPath[len] = '\0';
-                }
+                kill(pid, SIGKILL);
+                deadline = 0;
             }
+        } else if (done == 0) {
+            usleep(100000);
         }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+#endif
+}
+
+// The supervisor: --aot-train <timeout> <confPath|-> <envCount> <NAME=value>...
+//                 <workloadCount> <java> <args>... [<java> <create step args>...]
+int runAOTTraining(int argc, char** argv) {
+    if (argc < 5) return 2;
+    int timeoutSeconds = atoi(argv[0]);
+    const char* confPath = argv[1];
+    int envCount = atoi(argv[2]);
+    int pos = 3;
+    if (envCount < 0 || envCount > argc - pos - 2) return 2;
+
+#ifndef _WIN32
+    // The priority the launcher could not give through posix_spawn; the JVMs inherit
+    // it (Windows: IDLE_PRIORITY_CLASS from CreateProcess is inherited the same way)
+    setpriority(PRIO_PROCESS, 0, 19);
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    syscall(SYS_ioprio_set, 1 /* IOPRIO_WHO_PROCESS */, 0, 3 << 13 /* IOPRIO_CLASS_IDLE */);
+#endif
+#endif
+
+    for (int i = 0; i < envCount; i++) {
+#ifdef _WIN32
+        _putenv(argv[pos + i]);
+#else
+        putenv(argv[pos + i]);
+#endif
+    }
+    pos += envCount;
+
+    int workloadCount = atoi(argv[pos++]);
+    if (workloadCount < 1 || workloadCount > argc - pos) return 2;
+    int createCount = argc - pos - workloadCount;
+
+    // argv entries are not NULL-terminated per step
+    char** workload = (char**)arenaAlloc((size_t)(workloadCount + 1) * sizeof(char*));
+    char** create = (char**)arenaAlloc((size_t)(createCount + 1) * sizeof(char*));
+    if (!workload || !create) return 1;
+    memcpy(workload, argv + pos, (size_t)workloadCount * sizeof(char*));
+    workload[workloadCount] = NULL;
+    memcpy(create, argv + pos + workloadCount, (size_t)createCount * sizeof(char*));
+    create[createCount] = NULL;
+
+    BOOL recorded = createCount > 0 && strcmp(confPath, "-") != 0;
+    if (recorded) remove(confPath);  // Left by an interrupted training
+
+    int code = runTrainingStep(workload, workloadCount, timeoutSeconds);
+    if (!recorded) return code;
+
+    if (!isRegularFile(confPath)) {
+        fprintf(stderr, "jr: the training run recorded no AOT configuration (exit code %d)\n", code);
+        return 1;
+    }
+    code = runTrainingStep(create, createCount, 0);
+    remove(confPath);
+    return code;
+}
+
+// Start the training supervisor unless a training for this cache is already running.
+// Output goes to <exename>.train.log
+void startAOTTraining(const char* exeBaseName, const LaunchPlan* plan) {
+    char cacheDir[MAX_PATH];
+    char lockPath[MAX_PATH + 8];
+    char lockSuffix[16];
+    char logPath[MAX_PATH];
+    char exePath[MAX_PATH];
+    char confPath[MAX_PATH + 8];
+    char timeoutStr[16], envCountStr[16], workloadCountStr[16];
+
+    if (!getUserCacheDir(cacheDir, sizeof(cacheDir))) return;
+    if (snprintf(logPath, sizeof(logPath), "%s" PATH_SEP "%s.train.log", cacheDir, exeBaseName) >= (int)sizeof(logPath)) {
+        return;
+    }
+    getExePath(exePath, sizeof(exePath));
+    if (!exePath[0] || !createUserCacheDir()) return;
+
+    // The lock is keyed like its output: a JAR update gets a new lock, and the previous
+    // version's lock is removed on the next training (Windows keeps one that is still held)
+    const char* cacheSuffix = strrchr(plan->aotPath, '.');
+    if (!cacheSuffix) return;
+    if (snprintf(lockPath, sizeof(lockPath), "%s.lock", plan->aotPath) >= (int)sizeof(lockPath) ||
+        snprintf(lockSuffix, sizeof(lockSuffix), "%s.lock", cacheSuffix) >= (int)sizeof(lockSuffix)) {
+        return;
+    }
+    cleanupOldCacheFiles(plan->jarPath, lockPath, lockSuffix);
+
+    if (plan->createArgs.count > 0) {
+        if (snprintf(confPath, sizeof(confPath), "%sconf", plan->aotPath) >= (int)sizeof(confPath)) return;
+    } else {
+        strcpy(confPath, "-");
+    }
+    snprintf(timeoutStr, sizeof(timeoutStr), "%d", plan->trainTimeout);
+    snprintf(envCountStr, sizeof(envCountStr), "%d", plan->trainEnv.count);
+    snprintf(workloadCountStr, sizeof(workloadCountStr), "%d", plan->trainArgs.count + 1);
+
+    // <exe> --aot-train <timeout> <conf> <envCount> <env>... <workloadCount> <java> <trainArgs>...
+    //       [<java> <createArgs>...]
+    int argc = 0;
+    char** argv = (char**)arenaAlloc((size_t)(plan->trainEnv.count + plan->trainArgs.count +
+                                              plan->createArgs.count + 10) * sizeof(char*));
+    if (!argv) return;
+    argv[argc++] = exePath;
+    argv[argc++] = "--aot-train";
+    argv[argc++] = timeoutStr;
+    argv[argc++] = confPath;
+    argv[argc++] = envCountStr;
+    for (int i = 0; i < plan->trainEnv.count; i++) argv[argc++] = plan->trainEnv.items[i];
+    argv[argc++] = workloadCountStr;
+    argv[argc++] = (char*)plan->javaPath;
+    for (int i = 0; i < plan->trainArgs.count; i++) argv[argc++] = plan->trainArgs.items[i];
+    if (plan->createArgs.count > 0) {
+        argv[argc++] = (char*)plan->javaPath;
+        for (int i = 0; i < plan->createArgs.count; i++) argv[argc++] = plan->createArgs.items[i];
+    }
+    argv[argc] = NULL;
+
+#ifdef _WIN32
+    // An exclusive open is the lock; the inherited handle keeps it until the training ends
+    SECURITY_ATTRIBUTES inherit = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+    HANDLE lock = CreateFileA(lockPath, GENERIC_WRITE, 0, &inherit, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (lock == INVALID_HANDLE_VALUE) {
+        writeLog("INFO", "AOT training already running: %s", lockPath);
+        return;
+    }
+    // The previous training may have finished since the plan was made
+    if (isRegularFile(plan->aotPath)) {
+        CloseHandle(lock);
+        return;
+    }
+
+    char* cmdLine = joinArguments(argv, argc);
+    HANDLE logFile = CreateFileA(logPath, GENERIC_WRITE, FILE_SHARE_READ, &inherit,
+                                 CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    HANDLE nul = CreateFileA("NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, &inherit,
+                             OPEN_EXISTING, 0, NULL);
+
+    STARTUPINFOA si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = nul;
+    si.hStdOutput = logFile;
+    si.hStdError = logFile;
+
+    BOOL started = cmdLine && CreateProcessA(NULL, cmdLine, NULL, NULL, TRUE,
+                                             IDLE_PRIORITY_CLASS | CREATE_NO_WINDOW | CREATE_NEW_PROCESS_GROUP,
+                                             NULL, NULL, &si, &pi);
+    if (logFile != INVALID_HANDLE_VALUE) CloseHandle(logFile);
+    if (nul != INVALID_HANDLE_VALUE) CloseHandle(nul);
+    CloseHandle(lock);
+    if (!started) {
+        writeLog("WARNING", "Could not start the AOT training run (error %lu)", GetLastError());
+        return;
+    }
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+    writeLog("INFO", "Started AOT training (PID: %lu), log: %s", pi.dwProcessId, logPath);
+#else
+    // flock() belongs to the open file, so the inherited descriptor keeps it until the training ends
+    int lock = open(lockPath, O_WRONLY | O_CREAT, 0600);
+    if (lock < 0) return;
+    if (flock(lock, LOCK_EX | LOCK_NB) != 0) {
+        close(lock);
+        writeLog("INFO", "AOT training already running: %s", lockPath);
+        return;
+    }
+    // The previous training may have finished since the plan was made
+    if (isRegularFile(plan->aotPath)) {
+        close(lock);
+        return;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, logPath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+
+    // New session: the training outlives the launch and ignores its terminal
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+#ifdef POSIX_SPAWN_SETSID
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+#endif
+
+    pid_t pid;
+    int rc = posix_spawn(&pid, exePath, &actions, &attr, argv, environ);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    close(lock);
+    if (rc != 0) {
+        writeLog("WARNING", "Could not start the AOT training run (error %d)", rc);
+        return;
+    }
+    writeLog("INFO", "Started AOT training (PID: %ld), log: %s", (long)pid, logPath);
+#endif
+}
+
+// Resolve the launch from .jrc settings and the command line: Java lookup,
+// launch mode and AOT decision. Returns FALSE when the launcher should exit
+// instead (help, --create-config, errors) with the exit code in *exitCode
+BOOL resolveLaunchPlan(const LauncherOptions* options, const char* configPath, const char* exeBaseName,
+                       BOOL hasConsole, const LauncherConfig* config, int useConfig,
+                       LaunchPlan* plan, int* exitCode) {
+    const char* javaExeName = hasConsole ? JAVA_EXE : JAVAW_EXE;
+    char* javaPath = plan->javaPath;
+    char* jarFilePath = plan->jarPath;
 
+    // Check for --create-config flag
+    if (options->createConfig) {
         // Create config file
-        if (createConfigFile(configPath, jarPath[0] ? jarPath : NULL)) {
-            char msg[1024];
+        if (createConfigFile(configPath, options->createConfigJar)) {
+            char msg[MAX_PATH + 128];
             snprintf(msg, sizeof(msg), "Created config file: %s\n\nEdit this file to customize launcher behavior.", configPath);
             showMessage(hasConsole, "Config Created", msg, MB_ICONINFORMATION);
-            closeLog();
-            return 0;
+            *exitCode = 0;
+            return FALSE;
         } else {
-            char msg[1024];
+            char msg[MAX_PATH + 128];
             snprintf(msg, sizeof(msg), "Failed to create config file: %s", configPath);
             showMessage(hasConsole, "Error", msg, MB_ICONERROR);
-            closeLog();
-            return 1;
+            *exitCode = 1;
+            return FALSE;
         }
     }
 
+
     // Determine AOT setting (priority: cmdline > config > default)
     int enableAOT = 1; // Default: enabled
-    if (strstr(fullCmdLine, "--disable-aot")) {
-        enableAOT = 0;
-    } else if (strstr(fullCmdLine, "--enable-aot")) {
-        enableAOT = 1;
-    } else if (useConfig && config.enableAOT != -1) {
-        enableAOT = config.enableAOT;
+    if (options->enableAOT != -1) {
+        enableAOT = options->enableAOT;
+    } else if (useConfig && config->enableAOT != -1) {
+        enableAOT = config->enableAOT;
     }
 
     writeLog("INFO", "AOT enabled: %s", enableAOT ? "true" : "false");
 
-    // Check for --java-home override
-    char* javaHome = extractJavaHome(fullCmdLine);
+    // Determine launch mode (priority: cmdline > config > default)
+    int launchMode = LAUNCH_MODE_SPAWN;
+    if (options->launchMode != -1) {
+        launchMode = options->launchMode;
+    } else if (useConfig && config->launchMode != -1) {
+        launchMode = config->launchMode;
+    }
+#ifdef _WIN32
+    if (launchMode == LAUNCH_MODE_EXEC) {
+        // Windows has no exec: _execv is spawn+exit and would detach the console wait
+        writeLog("WARNING", "launch.mode=exec is not supported on Windows, using spawn");
+        launchMode = LAUNCH_MODE_SPAWN;
+    }
+#endif
+#ifndef JR_JNI_HOSTING
+    if (launchMode == LAUNCH_MODE_JNI) {
+        writeLog("WARNING", "launch.mode=jni needs a launcher built with JR_JNI_HOSTING, using spawn");
+        launchMode = LAUNCH_MODE_SPAWN;
+    }
+#endif
+    plan->launchMode = launchMode;
+
+    writeLog("INFO", "Launch mode: %s", launchMode == LAUNCH_MODE_EXEC ? "exec" :
+                                        launchMode == LAUNCH_MODE_JNI ? "jni" : "spawn");
 
-    if (javaHome) {
+    // Check for --java-home override
+    long long phaseStart = getElapsedMicros();
+    if (options->javaHome) {
         // Use the specified Java home
-        snprintf(javaPath, sizeof(javaPath), "%s\\bin\\%s", javaHome, javaExeName);
-        writeLog("INFO", "Using custom Java home: %s", javaHome);
+        int javaPathLen = snprintf(javaPath, MAX_PATH, "%s" PATH_SEP "bin" PATH_SEP "%s", options->javaHome, javaExeName);
+        writeLog("INFO", "Using custom Java home: %s", options->javaHome);
 
-        // Verify the path exists
-        DWORD attrib = GetFileAttributesA(javaPath);
-        if (attrib == INVALID_FILE_ATTRIBUTES || (attrib & FILE_ATTRIBUTE_DIRECTORY)) {
-            char error[1024];
+        // Verify the path exists (a cut-off path names some other file)
+        if (javaPathLen >= MAX_PATH || !isRegularFile(javaPath)) {
+            char error[MAX_PATH + 128];
             snprintf(error, sizeof(error),
                      "Java not found at specified location:\n%s\n\nPlease check your --java-home path.",
                      javaPath);
             showMessage(hasConsole, "Java Not Found", error, MB_ICONERROR);
-            free(javaHome);
-            closeLog();
-            return 1;
+            *exitCode = 1;
+            return FALSE;
         }
-
-        free(javaHome);
     } else {
         // Try to find Java in PATH
-        if (!findJavaInPath(javaExeName, javaPath, sizeof(javaPath))) {
+        if (!findJavaInPath(javaExeName, javaPath, MAX_PATH)) {
             char error[1024];
             snprintf(error, sizeof(error),
                      "Java not found in PATH.\n\n"
                      "Please ensure Java is installed and added to PATH,\n"
-                     "or use --java-home=C:\\path\\to\\jdk to specify location.\n\n"
+                     "or use --java-home=" JAVA_HOME_EXAMPLE " to specify location.\n\n"
                      "Looking for: %s",
                      javaExeName);
             showMessage(hasConsole, "Java Not Found", error, MB_ICONERROR);
-            closeLog();
-            return 1;
+            *exitCode = 1;
+            return FALSE;
         }
         writeLog("INFO", "Found Java in PATH: %s", javaPath);
     }
+    recordPhase(PHASE_JAVA_LOOKUP, phaseStart);
 
-    // Build final command line
-    char finalCmdLine[MAX_CMD_LEN];
-    char timingProps[512];
-    char aotArg[MAX_PATH + 50] = {0};
-    char jarFilePath[MAX_PATH] = {0};
-
-    // Measure time before JVM invocation
-    long long beforeJVMInvokeMicros = getElapsedMicros();
+    // Command-line arguments after the launcher options
+    char** cmdArgs = options->appArgs;
+    int cmdArgCount = options->appArgCount;
 
-    // Build timing system properties
-    snprintf(timingProps, sizeof(timingProps),
-             "-Djarrunner.start.micros=%lld -Djarrunner.beforejvm.micros=%lld",
-             startTimeMicros, beforeJVMInvokeMicros);
+    // Config mode: java.args tokens, searched for -jar <path>
+    ArgList configJavaArgs;
+    memset(&configJavaArgs, 0, sizeof(configJavaArgs));
 
-    if (useConfig && config.javaArgs[0]) {
+    if (useConfig && config->javaArgs[0]) {
         // Config mode: build command from config
         writeLog("INFO", "Using config-based mode");
 
         // Extract JAR path for AOT (if using -jar)
-        extractJarPath(config.javaArgs, jarFilePath, sizeof(jarFilePath));
-
-        // Build AOT cache path if enabled
-        if (enableAOT && jarFilePath[0]) {
-            char aotCachePath[MAX_PATH];
-            buildAOTCacheName(jarFilePath, aotCachePath, sizeof(aotCachePath));
-
-            if (aotCachePath[0]) {
-                // Clean up old AOT files
-                cleanupOldAOTFiles(jarFilePath, aotCachePath);
-
-                // Check if AOT cache exists
-                DWORD attrib = GetFileAttributesA(aotCachePath);
-                BOOL aotExists = (attrib != INVALID_FILE_ATTRIBUTES && !(attrib & FILE_ATTRIBUTE_DIRECTORY));
-
-                if (aotExists) {
-                    snprintf(aotArg, sizeof(aotArg), "-XX:AOTCache=\"%s\"", aotCachePath);
-                    writeLog("INFO", "Using existing AOT cache: %s", aotCachePath);
-                } else {
-                    snprintf(aotArg, sizeof(aotArg), "-XX:AOTCacheOutput=\"%s\"", aotCachePath);
-                    writeLog("INFO", "Creating new AOT cache: %s", aotCachePath);
-                }
-            }
-        }
-
-        // Get command-line args (skip past exe name)
-        char cmdLineArgs[MAX_CMD_LEN] = {0};
-        char* argsStart = fullCmdLine;
-        if (*argsStart == '"') {
-            argsStart = strchr(argsStart + 1, '"');
-            if (argsStart) argsStart += 2;
-        } else {
-            argsStart = strchr(argsStart, ' ');
-            if (argsStart) argsStart++;
-        }
-        if (argsStart) {
-            while (*argsStart == ' ') argsStart++;
-            // Remove --java-home if present
-            char tempArgs[MAX_CMD_LEN];
-            strncpy(tempArgs, argsStart, sizeof(tempArgs) - 1);
-            removeJavaHomeArg(tempArgs);
-            // Remove --disable-aot/--enable-aot flags
-            char* flag = strstr(tempArgs, "--disable-aot");
-            if (flag) {
-                char* end = flag + 13;
-                if (*end == ' ') end++;
-                memmove(flag, end, strlen(end) + 1);
-            }
-            flag = strstr(tempArgs, "--enable-aot");
-            if (flag) {
-                char* end = flag + 12;
-                if (*end == ' ') end++;
-                memmove(flag, end, strlen(end) + 1);
-            }
-            trim(tempArgs);
-            if (tempArgs[0]) {
-                strncpy(cmdLineArgs, tempArgs, sizeof(cmdLineArgs) - 1);
+        argListAddParsed(&configJavaArgs, config->javaArgs);
+        for (int i = 0; i + 1 < configJavaArgs.count; i++) {
+            if (strcmp(configJavaArgs.items[i], "-jar") == 0) {
+                strncpy(jarFilePath, configJavaArgs.items[i + 1], MAX_PATH - 1);
+                break;
             }
         }
-
-        // Build final command: java [timing] [vm.args] [aot] [java.args] [app.args] [cmdline-args]
-        int pos = snprintf(finalCmdLine, sizeof(finalCmdLine), "\"%s\" %s", javaPath, timingProps);
-
-        if (config.vmArgs[0]) {
-            pos += snprintf(finalCmdLine + pos, sizeof(finalCmdLine) - pos, " %s", config.vmArgs);
-        }
-
-        if (aotArg[0]) {
-            pos += snprintf(finalCmdLine + pos, sizeof(finalCmdLine) - pos, " %s", aotArg);
-        }
-
-        pos += snprintf(finalCmdLine + pos, sizeof(finalCmdLine) - pos, " %s", config.javaArgs);
-
-        if (config.appArgs[0]) {
-            pos += snprintf(finalCmdLine + pos, sizeof(finalCmdLine) - pos, " %s", config.appArgs);
-        }
-
-        if (cmdLineArgs[0]) {
-            snprintf(finalCmdLine + pos, sizeof(finalCmdLine) - pos, " %s", cmdLineArgs);
-        }
-
     } else {
         // Traditional mode: JAR as first argument
         writeLog("INFO", "Using traditional mode (no config file)");
 
-        // Skip past the executable name in command line
-        char* jarArgs = fullCmdLine;
-        if (*jarArgs == '"') {
-            jarArgs = strchr(jarArgs + 1, '"');
-            if (jarArgs) jarArgs += 2;
-        } else {
-            jarArgs = strchr(jarArgs, ' ');
-            if (jarArgs) jarArgs++;
+        // "jr -jar app.jar" is accepted as well as "jr app.jar"
+        if (cmdArgCount > 0 && strcmp(cmdArgs[0], "-jar") == 0) {
+            cmdArgs++;
+            cmdArgCount--;
         }
 
-        // Trim leading spaces
-        while (jarArgs && *jarArgs == ' ') jarArgs++;
-
-        if (!jarArgs || !*jarArgs) {
+        if (cmdArgCount == 0) {
             // Show diagnostic/help information
-            char info[2048];
+            char info[2048 + 8 * MAX_PATH];
             snprintf(info, sizeof(info),
                      "Java Runner (jr) - Smart Java Launcher\n\n"
                      "Execution Context: %s\n"
@@ -896,13 +4858,13 @@ int main(int argc, char** argv) {
                      "Java Location: %s\n"
                      "Config File: %s (not found)\n\n"
                      "Usage:\n"
-                     "  %s.exe <jar-file> [args...]\n"
-                     "  %s.exe --create-config [jar-file]\n"
-                     "  %s.exe --java-home=PATH <jar-file> [args...]\n\n"
+                     "  %s" EXE_SUFFIX " <jar-file> [args...]\n"
+                     "  %s" EXE_SUFFIX " --create-config [jar-file]\n"
+                     "  %s" EXE_SUFFIX " --java-home=PATH <jar-file> [args...]\n\n"
                      "Examples:\n"
-                     "  %s.exe myapp.jar\n"
-                     "  %s.exe --create-config myapp.jar\n"
-                     "  %s.exe --java-home=C:\\Java\\jdk21 myapp.jar --verbose",
+                     "  %s" EXE_SUFFIX " myapp.jar\n"
+                     "  %s" EXE_SUFFIX " --create-config myapp.jar\n"
+                     "  %s" EXE_SUFFIX " --java-home=" JAVA_HOME_EXAMPLE " myapp.jar --verbose",
                      hasConsole ? "Console (terminal/cmd)" : "GUI (double-clicked)",
                      javaExeName,
                      javaPath,
@@ -910,147 +4872,569 @@ int main(int argc, char** argv) {
                      exeBaseName, exeBaseName, exeBaseName,
                      exeBaseName, exeBaseName, exeBaseName);
             showMessage(hasConsole, "Java Runner - Help", info, MB_ICONINFORMATION);
-            closeLog();
-            return 1;
+            *exitCode = 1;
+            return FALSE;
+        }
+
+        // Extract JAR file path
+        strncpy(jarFilePath, cmdArgs[0], MAX_PATH - 1);
+    }
+
+    // Learn what the selected JVM supports before emitting version-specific flags
+    JdkInfo jdk;
+    phaseStart = getElapsedMicros();
+    probeJdk(javaPath, &jdk);
+    recordPhase(PHASE_JDK_PROBE, phaseStart);
+    plan->jdkMajor = jdk.major;
+
+    // An explicit training workload (aot.train.args) is recorded with -XX:AOTMode=record
+    // and dumped by a create step, which JDK 24 supports as well
+    BOOL recordTraining = useConfig && config->aotTrainArgs && (jdk.features & JDK_FEATURE_AOT_CACHE);
+
+    // JDK 13-24 get the same cache lifecycle from a dynamic CDS archive (.jsa)
+    BOOL useCDS = FALSE;
+    if (enableAOT && !(jdk.features & JDK_FEATURE_AOT_OUTPUT) && !recordTraining) {
+        if (jdk.features & JDK_FEATURE_CDS_DYNAMIC) {
+            writeLog("INFO", "AOT cache needs JDK 25+, selected Java is %s; using a dynamic CDS archive",
+                     jdk.version);
+            useCDS = TRUE;
+        } else {
+            writeLog("INFO", "AOT cache needs JDK 25+ (CDS archives JDK 13+), selected Java is %s; AOT flags skipped",
+                     jdk.version[0] ? jdk.version : "unknown");
+            enableAOT = 0;
         }
+    }
 
-        // Remove --java-home from args
-        char tempArgs[MAX_CMD_LEN];
-        strncpy(tempArgs, jarArgs, sizeof(tempArgs) - 1);
-        removeJavaHomeArg(tempArgs);
+    // CRaC (crac=true): restore this JAR version's checkpoint, or run so the app takes
+    // one at JarRunner.ready(). Without CRaC support the AOT cache is used instead.
+    // A restored JVM keeps main's arguments from the checkpoint run, so the image is also
+    // keyed on the .jrc arguments, and launches with command-line arguments run normally
+    char cracArg[MAX_PATH + 50] = {0};
+    plan->cracMode = CRAC_MODE_NONE;
+    plan->aotContentKey = useConfig && config->aotContentKey && jarFilePath[0];
+    if (useConfig && config->crac && jarFilePath[0]) {
+        if (!(jdk.features & JDK_FEATURE_CRAC)) {
+            writeLog("INFO", "crac=true needs a CRaC JDK (lib/criu), using the AOT cache instead");
+        } else if (plan->serverMode != SERVER_MODE_OFF || launchMode == LAUNCH_MODE_JNI) {
+            writeLog("INFO", "crac=true is ignored with server mode and launch=jni");
+        } else if (cmdArgCount > 0) {
+            writeLog("INFO", "crac=true is ignored with command-line arguments (a restore would run the checkpoint's arguments)");
+        } else {
+            // <jarname>.<version>.<args_base52>.crac, still matched by the .crac cleanup
+            unsigned long long argsHash = hashString(config->vmArgs, FNV_OFFSET_BASIS) * FNV_PRIME;
+            for (int i = 0; i < config->versionedVmArgsCount; i++) {
+                argsHash = hashString(config->versionedVmArgs[i].args, argsHash) * FNV_PRIME;
+            }
+            argsHash = hashString(config->javaArgs, argsHash) * FNV_PRIME;
+            argsHash = hashString(config->appArgs, argsHash);
 
-        // Remove AOT flags
-        char* flag = strstr(tempArgs, "--disable-aot");
-        if (flag) {
-            char* end = flag + 13;
-            if (*end == ' ') end++;
-            memmove(flag, end, strlen(end) + 1);
-            trim(tempArgs);
+            char argsHashStr[32], cracSuffix[48];
+            encodeBase52(argsHash, argsHashStr, sizeof(argsHashStr));
+            snprintf(cracSuffix, sizeof(cracSuffix), ".%s.crac", argsHashStr);
+            buildCachePath(jarFilePath, cracSuffix, plan->aotContentKey, plan->cracPath, sizeof(plan->cracPath));
         }
-        flag = strstr(tempArgs, "--enable-aot");
-        if (flag) {
-            char* end = flag + 12;
-            if (*end == ' ') end++;
-            memmove(flag, end, strlen(end) + 1);
-            trim(tempArgs);
+    }
+    if (plan->cracPath[0]) {
+        phaseStart = getElapsedMicros();
+        plan->aotCleanups += cleanupOldCacheFiles(jarFilePath, plan->cracPath, ".crac");
+        recordPhase(PHASE_AOT_CLEANUP, phaseStart);
+
+        if (hasCRaCImage(plan->cracPath)) {
+            plan->cracMode = CRAC_MODE_RESTORE;
+            snprintf(cracArg, sizeof(cracArg), "-XX:CRaCRestoreFrom=%s", plan->cracPath);
+            writeLog("INFO", "Restoring CRaC checkpoint: %s", plan->cracPath);
+        } else if (hasConsole && launchMode == LAUNCH_MODE_SPAWN) {
+            // The launcher restores the image as soon as the checkpointed JVM is gone
+            plan->cracMode = CRAC_MODE_CHECKPOINT;
+            snprintf(cracArg, sizeof(cracArg), "-XX:CRaCCheckpointTo=%s", plan->cracPath);
+            writeLog("INFO", "Creating CRaC checkpoint at JarRunner.ready(): %s", plan->cracPath);
+        } else {
+            writeLog("INFO", "CRaC checkpoints are only taken by console launches in spawn mode, using the AOT cache");
+            plan->cracPath[0] = '\0';
         }
+        if (plan->cracMode != CRAC_MODE_NONE) enableAOT = 0;
+    }
 
-        // Extract JAR file path
-        extractJarPath(tempArgs, jarFilePath, sizeof(jarFilePath));
-        if (!jarFilePath[0]) {
-            // Maybe it's just a direct JAR path (not -jar format)
-            char* firstArg = tempArgs;
-            if (*firstArg == '"') {
-                firstArg++;
-                char* endQuote = strchr(firstArg, '"');
-                if (endQuote) {
-                    size_t len = endQuote - firstArg;
-                    if (len < sizeof(jarFilePath)) {
-                        strncpy(jarFilePath, firstArg, len);
-                        jarFilePath[len] = '\0';
-                    }
-                }
+    // Build AOT cache path if enabled
+    char aotArg[MAX_PATH + 50] = {0};
+    const char* aotFlag = NULL;    // Second cache flag (-XX:+AutoCreateSharedArchive)
+    plan->aotMode = AOT_MODE_NONE;
+    if (enableAOT && jarFilePath[0]) {
+        const char* cacheSuffix = useCDS ? ".jsa" : ".aot";
+        phaseStart = getElapsedMicros();
+        buildCachePath(jarFilePath, cacheSuffix, plan->aotContentKey, plan->aotPath, sizeof(plan->aotPath));
+        recordPhase(PHASE_AOT_NAME, phaseStart);
+
+        if (plan->aotPath[0]) {
+            // Clean up old AOT files
+            phaseStart = getElapsedMicros();
+            plan->aotCleanups += cleanupOldCacheFiles(jarFilePath, plan->aotPath, cacheSuffix);
+            recordPhase(PHASE_AOT_CLEANUP, phaseStart);
+
+            // Check if AOT cache exists
+            phaseStart = getElapsedMicros();
+            BOOL aotExists = isRegularFile(plan->aotPath);
+            recordPhase(PHASE_AOT_NAME, phaseStart);
+            plan->aotMode = aotExists ? AOT_MODE_USE : AOT_MODE_CREATE;
+            if (useCDS && (jdk.features & JDK_FEATURE_CDS_AUTO)) {
+                // JDK 19+ dumps the archive at exit when it is missing or was made by another JVM
+                snprintf(aotArg, sizeof(aotArg), "-XX:SharedArchiveFile=%s", plan->aotPath);
+                aotFlag = "-XX:+AutoCreateSharedArchive";
+            } else if (useCDS) {
+                snprintf(aotArg, sizeof(aotArg), aotExists ? "-XX:SharedArchiveFile=%s" : "-XX:ArchiveClassesAtExit=%s",
+                         plan->aotPath);
             } else {
-                char* end = strchr(firstArg, ' ');
-                if (!end) end = firstArg + strlen(firstArg);
-                size_t len = end - firstArg;
-                if (len < sizeof(jarFilePath)) {
-                    strncpy(jarFilePath, firstArg, len);
-                    jarFilePath[len] = '\0';
-                }
+                snprintf(aotArg, sizeof(aotArg), aotExists ? "-XX:AOTCache=%s" : "-XX:AOTCacheOutput=%s",
+                         plan->aotPath);
             }
+            writeLog("INFO", "%s %s: %s", aotExists ? "Using existing" : "Creating new",
+                     useCDS ? "CDS archive" : "AOT cache", plan->aotPath);
         }
+    }
 
-        // Build AOT cache path if enabled
-        if (enableAOT && jarFilePath[0]) {
-            char aotCachePath[MAX_PATH];
-            buildAOTCacheName(jarFilePath, aotCachePath, sizeof(aotCachePath));
+    // aot.background / aot.train.args: this launch runs without the cache, a
+    // low-priority run creates it
+    char trainArg[MAX_PATH + 50] = {0};
+    const char* trainFlag = NULL;
+    if (plan->aotMode == AOT_MODE_CREATE && useConfig && (config->aotBackground || config->aotTrainArgs)) {
+        writeLog("INFO", "Cache will be created by a background training run");
+        memcpy(trainArg, aotArg, sizeof(trainArg));
+        trainFlag = aotFlag;
+        aotArg[0] = '\0';
+        aotFlag = NULL;
+        plan->aotMode = AOT_MODE_NONE;
+        plan->aotTrain = 1;
+        plan->trainTimeout = config->aotTrainTimeout;
+        if (recordTraining) {
+            trainFlag = "-XX:AOTMode=record";
+            snprintf(trainArg, sizeof(trainArg), "-XX:AOTConfiguration=%sconf", plan->aotPath);
+        }
+    }
+    int cacheArgsAt = 0;           // Where the training run's cache flags go
+    int appArgsAt = 0;             // Where the arguments aot.train.args replaces start
+
+    // Everything after the timing properties, one vector entry per argument
+    ArgList* javaArgs = &plan->javaArgs;
+    int ok = 1;
+    phaseStart = getElapsedMicros();
+
+    if (plan->cracMode == CRAC_MODE_RESTORE) {
+        // The image is the whole JVM, main's arguments included; only new -D properties apply
+        ok = argListAdd(javaArgs, cracArg);
+        cmdArgCount = 0;
+    } else if (useConfig && config->javaArgs[0]) {
+        // Config mode: [vm.args] [vm.args.<range>...] [aot|crac] [java.args] [app.args] [cmdline-args]
+        ok = argListAddParsed(javaArgs, config->vmArgs);
+
+        for (int i = 0; ok && i < config->versionedVmArgsCount; i++) {
+            const VersionedArgs* entry = &config->versionedVmArgs[i];
+            if (jdk.major > 0 && jdk.major >= entry->minMajor &&
+                (entry->maxMajor == 0 || jdk.major <= entry->maxMajor)) {
+                writeLog("INFO", "Applying version-specific vm.args for Java %d: %s", jdk.major, entry->args);
+                ok = argListAddParsed(javaArgs, entry->args);
+            }
+        }
 
-            if (aotCachePath[0]) {
-                // Clean up old AOT files
-                cleanupOldAOTFiles(jarFilePath, aotCachePath);
+        cacheArgsAt = javaArgs->count;
+        if (ok && aotFlag) ok = argListAdd(javaArgs, aotFlag);
+        if (ok && aotArg[0]) ok = argListAdd(javaArgs, aotArg);
+        if (ok && cracArg[0]) ok = argListAdd(javaArgs, cracArg);
+        if (ok && cracArg[0]) ok = argListAdd(javaArgs, "-Djarrunner.crac.checkpoint=true");
+        for (int i = 0; ok && i < configJavaArgs.count; i++) {
+            ok = argListAdd(javaArgs, configJavaArgs.items[i]);
+        }
+        if (ok) ok = argListAddParsed(javaArgs, config->appArgs);
+        appArgsAt = javaArgs->count;
+    } else {
+        // Traditional mode: [aot|crac] -jar <jar> [cmdline-args]
+        if (aotFlag) ok = argListAdd(javaArgs, aotFlag);
+        if (ok && aotArg[0]) ok = argListAdd(javaArgs, aotArg);
+        if (ok && cracArg[0]) ok = argListAdd(javaArgs, cracArg);
+        if (ok && cracArg[0]) ok = argListAdd(javaArgs, "-Djarrunner.crac.checkpoint=true");
+        if (ok) ok = argListAdd(javaArgs, "-jar");
+        appArgsAt = javaArgs->count + 1;
+    }
 
-                // Check if AOT cache exists
-                DWORD attrib = GetFileAttributesA(aotCachePath);
-                BOOL aotExists = (attrib != INVALID_FILE_ATTRIBUTES && !(attrib & FILE_ATTRIBUTE_DIRECTORY));
+    for (int i = 0; ok && i < cmdArgCount; i++) {
+        ok = argListAdd(javaArgs, cmdArgs[i]);
+    }
 
-                if (aotExists) {
-                    snprintf(aotArg, sizeof(aotArg), "-XX:AOTCache=\"%s\"", aotCachePath);
-                    writeLog("INFO", "Using existing AOT cache: %s", aotCachePath);
-                } else {
-                    snprintf(aotArg, sizeof(aotArg), "-XX:AOTCacheOutput=\"%s\"", aotCachePath);
-                    writeLog("INFO", "Creating new AOT cache: %s", aotCachePath);
-                }
+    // Training run: the same command with the create (or record) flags, a marker
+    // property and aot.train.args in place of the command-line arguments. After a
+    // recorded run, the create step dumps <aot>conf into the cache without running main
+    if (ok && plan->aotTrain) {
+        ArgList* trainArgs = &plan->trainArgs;
+        if (appArgsAt > javaArgs->count) appArgsAt = javaArgs->count;
+        for (int i = 0; ok && i < cacheArgsAt; i++) {
+            ok = argListAdd(trainArgs, javaArgs->items[i]);
+        }
+        if (ok && trainFlag) ok = argListAdd(trainArgs, trainFlag);
+        if (ok) ok = argListAdd(trainArgs, trainArg);
+        if (ok) ok = argListAdd(trainArgs, "-Djarrunner.aot.training=true");
+        int trainEnd = config->aotTrainArgs ? appArgsAt : javaArgs->count;
+        for (int i = cacheArgsAt; ok && i < trainEnd; i++) {
+            ok = argListAdd(trainArgs, javaArgs->items[i]);
+        }
+        if (ok && config->aotTrainArgs) ok = argListAddParsed(trainArgs, config->aotTrainArgs);
+        if (ok && config->aotTrainEnv) ok = argListAddParsed(&plan->trainEnv, config->aotTrainEnv);
+
+        if (recordTraining) {
+            ArgList* createArgs = &plan->createArgs;
+            char cacheArg[MAX_PATH + 50];
+            snprintf(cacheArg, sizeof(cacheArg), "-XX:AOTCache=%s", plan->aotPath);
+            for (int i = 0; ok && i < cacheArgsAt; i++) {
+                ok = argListAdd(createArgs, javaArgs->items[i]);
+            }
+            if (ok) ok = argListAdd(createArgs, "-XX:AOTMode=create");
+            if (ok) ok = argListAdd(createArgs, trainArg);
+            if (ok) ok = argListAdd(createArgs, cacheArg);
+            for (int i = cacheArgsAt; ok && i < appArgsAt; i++) {
+                ok = argListAdd(createArgs, javaArgs->items[i]);
             }
         }
+    }
+    recordPhase(PHASE_COMMAND, phaseStart);
 
-        // Build final command: java [timing] [aot] -jar <remaining args>
-        if (aotArg[0]) {
-            snprintf(finalCmdLine, sizeof(finalCmdLine), "\"%s\" %s %s -jar %s",
-                     javaPath, timingProps, aotArg, tempArgs);
-        } else {
-            snprintf(finalCmdLine, sizeof(finalCmdLine), "\"%s\" %s -jar %s",
-                     javaPath, timingProps, tempArgs);
-        }
+    if (!ok) {
+        showMessage(hasConsole, "Error", "Out of memory while building the Java command line.", MB_ICONERROR);
+        *exitCode = 1;
+        return FALSE;
     }
 
-    writeLog("INFO", "Final command: %s", finalCmdLine);
+    return TRUE;
+}
 
-    // Setup startup info
-    STARTUPINFOA si = {sizeof(si)};
-    PROCESS_INFORMATION pi;
-    ZeroMemory(&si, sizeof(si));
-    si.cb = sizeof(si);
+int main(int argc, char** argv) {
+    char exeBaseName[MAX_PATH] = {0};
+    char configPath[MAX_PATH] = {0};
+    char planPath[MAX_PATH] = {0};
+    static LauncherConfig config;
+    static LaunchPlan plan;
+    int useConfig = 0;
+    int exitCode = 0;
 
-    if (hasConsole) {
-        // In console mode, explicitly pass the console handles
-        si.dwFlags = STARTF_USESTDHANDLES;
-        si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
-        si.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
-        si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    // Initialize high-resolution timer
+    initTimer();
+    long long startTimeMicros = getElapsedMicros();
+
+    // Get executable base name (without .exe) - for display purposes
+    long long phaseStart = startTimeMicros;
+    getExeBaseName(exeBaseName, sizeof(exeBaseName));
+
+    // Build config file path - use full path so it works from any directory
+    getExeFullPathWithoutExt(configPath, sizeof(configPath));
+    strncat(configPath, ".jrc", sizeof(configPath) - strlen(configPath) - 1);
+    recordPhase(PHASE_EXE_NAME, phaseStart);
+
+    // Detect if we're in GUI mode (double-clicked) or console mode (terminal)
+    phaseStart = getElapsedMicros();
+    BOOL guiMode = isGuiMode();
+    BOOL hasConsole = !guiMode;
+    recordPhase(PHASE_CONSOLE, phaseStart);
+
+    // Split launcher options from the JAR/application arguments (argv is already
+    // tokenized by the C runtime on both platforms)
+    LauncherOptions options;
+    parseLauncherOptions(argc, argv, &options);
+
+    if (options.stats) {
+        return printLaunchStats(options.statsApp, hasConsole);
+    }
+    if (options.aotTrain) {
+        return runAOTTraining(options.appArgCount, options.appArgs);
     }
 
-    // Inherit handles so console I/O works
-    if (CreateProcessA(NULL, finalCmdLine, NULL, NULL, TRUE,
-                      0, NULL, NULL, &si, &pi)) {
+    // Fast path: an identical earlier invocation left a still-valid launch plan
+    LaunchPlanKey planKey;
+    phaseStart = getElapsedMicros();
+    BOOL planCache = !options.noPlanCache &&
+                     getLaunchPlanPath(exeBaseName, planPath, sizeof(planPath));
+    BOOL planLoaded = FALSE;
+    if (planCache) {
+        buildLaunchPlanKey(&planKey, configPath, argc, argv, hasConsole);
+        planLoaded = loadLaunchPlan(planPath, &planKey, &plan);
+        recordPhase(PHASE_PLAN, phaseStart);
+    }
+
+    if (planLoaded) {
+        phaseStart = getElapsedMicros();
+        initLog(plan.logFile, plan.logOverwrite, plan.logLevel, plan.logFormat);
+        recordPhase(PHASE_LOG_INIT, phaseStart);
+        writeLog("INFO", "Launcher started: %s" EXE_SUFFIX, exeBaseName);
+        writeLog("INFO", "Execution mode: %s", hasConsole ? "Console" : "GUI");
+        writeLog("INFO", "Using cached launch plan: %s", planPath);
+    } else {
+        // Try to load config file
+        phaseStart = getElapsedMicros();
+        useConfig = parseConfigFile(configPath, &config);
+        recordPhase(PHASE_CONFIG, phaseStart);
+
+        // Initialize logging if configured
+        if (useConfig && config.logFile[0]) {
+            phaseStart = getElapsedMicros();
+            plan.logLevel = parseLogLevel(config.logLevel);
+            plan.logFormat = config.logFormat;
+            initLog(config.logFile, config.logOverwrite, plan.logLevel, plan.logFormat);
+            recordPhase(PHASE_LOG_INIT, phaseStart);
+            writeLog("INFO", "Launcher started: %s" EXE_SUFFIX, exeBaseName);
+            snprintf(plan.logFile, sizeof(plan.logFile), "%s", config.logFile);
+            plan.logOverwrite = config.logOverwrite;
+        }
+        plan.journal = useConfig ? config.journal : 1;
+        if (useConfig) {
+            snprintf(plan.traceFile, sizeof(plan.traceFile), "%s", config.traceFile);
+            snprintf(plan.metricsDir, sizeof(plan.metricsDir), "%s", config.metricsDir);
+            plan.readyNotify = config.readyNotify;
+            plan.readySignal = config.readySignal || config.readyNotify;
+            plan.serverMode = config.serverMode;
+            plan.serverIdle = config.serverIdle;
+            plan.singleInstance = config.singleInstance;
+        }
 
-        writeLog("INFO", "Java process started successfully (PID: %lu)", pi.dwProcessId);
+        writeLog("INFO", "Execution mode: %s", hasConsole ? "Console" : "GUI");
+        writeLog("INFO", "Java executable: %s", hasConsole ? JAVA_EXE : JAVAW_EXE);
 
-        if (hasConsole) {
-            // Console mode: Wait for Java process to complete
-            WaitForSingleObject(pi.hProcess, INFINITE);
+        if (!resolveLaunchPlan(&options, configPath, exeBaseName, hasConsole,
+                               &config, useConfig, &plan, &exitCode)) {
+            closeLog();
+            return exitCode;
+        }
 
-            DWORD exitCode = 0;
-            GetExitCodeProcess(pi.hProcess, &exitCode);
+        if (planCache && (!useConfig || config.planCache)) {
+            phaseStart = getElapsedMicros();
+            saveLaunchPlan(planPath, &planKey, &plan);
+            recordPhase(PHASE_PLAN, phaseStart);
+        }
+    }
 
-            writeLog("INFO", "Java process exited with code: %lu", exitCode);
+    // Single instance: a running app takes over this launch, otherwise java learns
+    // where to listen for the next one
+    char instanceSocket[MAX_PATH] = {0};
+    char instanceArg[MAX_PATH + 32] = {0};
+    char instanceArgsArg[48] = {0};
+    if (plan.singleInstance &&
+        getInstanceSocketPath(exeBaseName, configPath, instanceSocket, sizeof(instanceSocket))) {
+        if (forwardToInstance(instanceSocket, options.appArgs, options.appArgCount, &exitCode)) {
+            writeLog("INFO", "Forwarded %d argument(s) to the running instance, exit code %d",
+                     options.appArgCount, exitCode);
+            closeLog();
+            return exitCode;
+        }
+        // The instance socket would be open at the CRaC checkpoint; such launches just run
+        if (plan.cracMode == CRAC_MODE_NONE && createUserCacheDir()) {
+            snprintf(instanceArg, sizeof(instanceArg), "-Djarrunner.instance.socket=%s", instanceSocket);
+            // How many of main's arguments are from the command line (after app.args), so a
+            // JVM that loses the start race forwards what the launcher would have
+            snprintf(instanceArgsArg, sizeof(instanceArgsArg), "-Djarrunner.instance.args=%d",
+                     options.appArgCount);
+        }
+    }
 
-            CloseHandle(pi.hProcess);
-            CloseHandle(pi.hThread);
+    // Cache miss with aot.background: started first, the plan's arguments do not outlive the launch
+    if (plan.aotTrain) {
+        startAOTTraining(exeBaseName, &plan);
+    }
 
+    // Warm JVM: the app runs in a resident or spare JVM, this process only relays.
+    // Needs a console to relay to; anything short of a started run falls back to java
+    if (plan.serverMode != SERVER_MODE_OFF && hasConsole) {
+        long long requestMicros = 0;
+        int serverResult = runOnServer(exeBaseName, &plan, &exitCode, &requestMicros);
+        if (serverResult == SERVER_RAN || serverResult == SERVER_FAILED) {
+            recordLaunch(exeBaseName, &plan, requestMicros, getElapsedMicros(), exitCode, NULL, 0);
+            const char* serverTrace = options.traceFile ? options.traceFile : plan.traceFile;
+            if (serverTrace[0]) {
+                writeTrace(serverTrace, exeBaseName, NULL, requestMicros, getElapsedMicros(), exitCode, 0);
+            }
+            // The next spare starts after the run, so its JVM init does not compete with it
+            if (plan.serverMode == SERVER_MODE_SPARE) startSpareServer(exeBaseName, &plan);
             closeLog();
             return exitCode;
+        }
+        if (serverResult == SERVER_UNAVAILABLE) {
+            writeLog("INFO", "No warm JVM available, launching java directly");
+            // Nothing to claim: the next spare starts once this launch has started up
+            if (plan.serverMode == SERVER_MODE_SPARE) deferSpareServer(exeBaseName, &plan);
+        }
+        plan.serverMode = SERVER_MODE_OFF;
+    }
+
+    // Build final argument vector: java [timing] [phase timings] [trace -Xlog] [ready] [instance] <plan args>
+    const char* javaPath = plan.javaPath;
+    int launchMode = plan.launchMode;
+    char startArg[64];
+    char beforeJvmArg[64];
+    char epochArg[64];
+    char nanoTimeArg[64];
+
+    // Startup trace: the JVM side is only complete if the launcher waits for java
+    const char* traceFile = options.traceFile ? options.traceFile : plan.traceFile;
+    // (not with CRaC: a checkpoint cannot contain the open log, a restore takes no -Xlog)
+    BOOL traceJvm = traceFile[0] && hasConsole && launchMode != LAUNCH_MODE_EXEC &&
+                    plan.cracMode == CRAC_MODE_NONE;
+    char jvmLogPath[MAX_PATH] = {0};
+    char xlogArg[MAX_PATH + 64] = {0};
+    if (traceJvm && snprintf(jvmLogPath, sizeof(jvmLogPath), "%s.jvm.log", traceFile) >= (int)sizeof(jvmLogPath)) {
+        writeLog("WARNING", "Trace path too long for the JVM log, tracing the launcher only");
+        traceJvm = FALSE;
+    }
+    if (traceJvm) {
+        buildTraceXlogArg(jvmLogPath, xlogArg, sizeof(xlogArg));
+    }
+
+    // Readiness needs a launcher that stays around to listen. With CRaC, ready() is where
+    // the checkpoint is taken, and an inherited pipe would keep CRIU from taking it
+    static ReadyChannel readyChannel;
+    ReadyChannel* ready = NULL;
+    if (plan.readySignal && hasConsole && launchMode == LAUNCH_MODE_SPAWN &&
+        plan.cracMode == CRAC_MODE_NONE) {
+        if (openReadyChannel(&readyChannel)) {
+            ready = &readyChannel;
         } else {
-            // GUI mode: Launch and exit immediately
-            CloseHandle(pi.hProcess);
-            CloseHandle(pi.hThread);
+            writeLog("WARNING", "Could not create the readiness channel, launching without it");
+        }
+    }
+
+    int phaseCount = 0;
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        if (g_phasesRun & (1u << i)) phaseCount++;
+    }
+
+    int prefixCount = 5 + phaseCount + (traceJvm ? 1 : 0) + (ready ? 1 : 0) + (instanceArg[0] ? 2 : 0);
+    int childArgc = prefixCount + plan.javaArgs.count;
+    char** childArgv = (char**)arenaAlloc((childArgc + 1) * sizeof(char*));
+    char* phaseArgs = (char*)arenaAlloc((size_t)phaseCount * 64 + 1);
+    if (!childArgv || !phaseArgs) {
+        closeLog();
+        return 1;
+    }
+    childArgv[0] = plan.javaPath;
+    childArgv[1] = startArg;
+    childArgv[2] = beforeJvmArg;
+    childArgv[3] = epochArg;
+    childArgv[4] = nanoTimeArg;
+    for (int i = 0; i < plan.javaArgs.count; i++) {
+        childArgv[prefixCount + i] = plan.javaArgs.items[i];
+    }
+    childArgv[childArgc] = NULL;
+
+    // Phase properties go right after the timing properties
+    int slot = 5;
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        if (g_phasesRun & (1u << i)) {
+            snprintf(phaseArgs, 64, "-Djarrunner.phase.%s.micros=%lld", PHASE_NAMES[i], g_phaseMicros[i]);
+            childArgv[slot++] = phaseArgs;
+            phaseArgs += 64;
+        }
+    }
+    if (traceJvm) {
+        childArgv[slot++] = xlogArg;
+    }
+    if (ready) {
+        childArgv[slot++] = ready->arg;
+    }
+    if (instanceArg[0]) {
+        childArgv[slot++] = instanceArg;
+        childArgv[slot++] = instanceArgsArg;
+    }
+
+    // Measure time before JVM invocation
+    long long beforeJVMInvokeMicros = getElapsedMicros();
 
-            writeLog("INFO", "Launched in GUI mode, launcher exiting");
+    snprintf(startArg, sizeof(startArg), "-Djarrunner.start.micros=%lld", startTimeMicros);
+    snprintf(beforeJvmArg, sizeof(beforeJvmArg), "-Djarrunner.beforejvm.micros=%lld", beforeJVMInvokeMicros);
+    // Absolute anchors for the relative timings: epoch for RuntimeMXBean.getStartTime(),
+    // monotonic for System.nanoTime() (same clock as the JVM on Linux and Windows)
+    snprintf(epochArg, sizeof(epochArg), "-Djarrunner.start.epoch.micros=%lld", g_startEpochMicros);
+    snprintf(nanoTimeArg, sizeof(nanoTimeArg), "-Djarrunner.start.nanotime=%lld", g_startNanoTime);
+
+    // Joined form is only for display; built when something will show it
+    char* finalCmdLine = isLogEnabled(LOG_LEVEL_INFO) ? joinArguments(childArgv, childArgc) : NULL;
+    writeLog("INFO", "Final command: %s", finalCmdLine ? finalCmdLine : javaPath);
+
+    unsigned long lastError = 0;
+
+#ifdef JR_JNI_HOSTING
+    if (launchMode == LAUNCH_MODE_JNI) {
+        logPhaseTimings();
+        flushLog();
+        if (hostJavaInProcess(javaPath, childArgv, childArgc, &exitCode)) {
+            runAfterStartup();
+            recordLaunch(exeBaseName, &plan, beforeJVMInvokeMicros, getElapsedMicros(), exitCode, NULL, 0);
+            if (traceFile[0]) {
+                writeTrace(traceFile, exeBaseName, jvmLogPath, beforeJVMInvokeMicros, getElapsedMicros(), exitCode, 0);
+                remove(jvmLogPath);
+            }
             closeLog();
-            return 0;
+            return exitCode;
+        }
+        writeLog("WARNING", "In-process hosting unavailable, falling back to spawn");
+        launchMode = LAUNCH_MODE_SPAWN;
+    }
+#endif
+
+    if (launchMode == LAUNCH_MODE_EXEC) {
+        // Nothing runs after exec: journal, metrics and trace cover the launcher only, and
+        // the journal marks the exit as unknown (if execv fails, the error path logs it)
+        recordLaunch(exeBaseName, &plan, beforeJVMInvokeMicros, 0, JOURNAL_EXIT_UNKNOWN, NULL, 0);
+        if (traceFile[0]) {
+            writeTrace(traceFile, exeBaseName, NULL, beforeJVMInvokeMicros, 0, 0, 0);
+        }
+    }
+
+    // The checkpointed JVM is gone once the checkpoint is taken; this launch continues
+    // by restoring it (built now, the arguments do not outlive the launch)
+    static char restoreArg[MAX_PATH + 50];
+    static char* restoreArgv[3];
+    if (plan.cracMode == CRAC_MODE_CHECKPOINT) {
+        snprintf(restoreArg, sizeof(restoreArg), "-XX:CRaCRestoreFrom=%s", plan.cracPath);
+        restoreArgv[0] = plan.javaPath;
+        restoreArgv[1] = restoreArg;
+        restoreArgv[2] = NULL;
+    }
+
+    ChildUsage childUsage;
+    if (launchProcess(javaPath, childArgv, hasConsole, launchMode, ready, plan.readyNotify,
+                      &exitCode, &childUsage, &lastError)) {
+        runAfterStartup();
+        if (plan.cracMode == CRAC_MODE_CHECKPOINT && hasCRaCImage(plan.cracPath)) {
+            writeLog("INFO", "CRaC checkpoint taken, restoring: %s", plan.cracPath);
+            if (!launchProcess(plan.javaPath, restoreArgv, hasConsole, launchMode, NULL, 0,
+                               &exitCode, &childUsage, &lastError)) {
+                writeLog("ERROR", "Could not restore the CRaC checkpoint (error %lu)", lastError);
+                exitCode = 1;
+            }
         }
+        long long readyMicros = ready ? ready->readyMicros : 0;
+        recordLaunch(exeBaseName, &plan, getJavaStartMicros(beforeJVMInvokeMicros),
+                     hasConsole ? getElapsedMicros() : 0, exitCode, &childUsage, readyMicros);
+        if (traceFile[0]) {
+            writeTrace(traceFile, exeBaseName, traceJvm ? jvmLogPath : NULL, beforeJVMInvokeMicros,
+                       hasConsole ? getElapsedMicros() : 0, exitCode, readyMicros);
+            if (traceJvm) remove(jvmLogPath);
+        }
+        closeLog();
+        return exitCode;
+    }
+
+    if (ready) closeReadyChannel(ready);
+
+    // A stale plan must not keep failing: drop it so the next run re-resolves
+    if (planLoaded) {
+        remove(planPath);
     }
 
-    // If we get here, CreateProcess failed
-    char error[2048];
-    DWORD lastError = GetLastError();
+    // If we get here, process creation failed (the arena is still intact)
+    if (!finalCmdLine) finalCmdLine = joinArguments(childArgv, childArgc);
+    // Long command lines are cut in the message box, the log has the full one
+    char error[2048 + MAX_PATH];
     snprintf(error, sizeof(error),
              "Failed to launch Java process.\n\n"
              "Java: %s\n"
-             "Command: %s\n"
+             "Command: %.1900s\n"
              "Error code: %lu\n\n"
              "Make sure Java is properly installed.",
-             javaPath, finalCmdLine, lastError);
+             javaPath, finalCmdLine ? finalCmdLine : javaPath, lastError);
     showMessage(hasConsole, "Launch Error", error, MB_ICONERROR);
 
     closeLog();
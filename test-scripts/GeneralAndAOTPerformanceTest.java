@@ -30,6 +30,7 @@ public class GeneralAndAOTPerformanceTest {
     public static void main(String[] args) {
         // Record when main() actually starts
         long mainStartTimeMs = System.currentTimeMillis();
+        long mainStartNanos = System.nanoTime();
 
         System.out.println("================================================================================");
         System.out.println("             COMPREHENSIVE TIMING ANALYSIS");
@@ -96,6 +97,29 @@ public class GeneralAndAOTPerformanceTest {
             System.out.println("[T+?ms]      jarrunner.exe started (timing not available)");
         }
 
+        // Absolute anchors (-Djarrunner.start.epoch.micros / .nanotime) place the JVM's own
+        // clocks on the launcher timeline
+        String epochMicrosStr = System.getProperty("jarrunner.start.epoch.micros");
+        String startNanoTimeStr = System.getProperty("jarrunner.start.nanotime");
+        if (epochMicrosStr != null && startNanoTimeStr != null) {
+            long epochMicros = Long.parseLong(epochMicrosStr);
+            long startNanoTime = Long.parseLong(startNanoTimeStr);
+            System.out.printf ("[T+%dms]    JVM created (RuntimeMXBean start time, ms resolution)%n",
+                (jvmStartTimeMs * 1000 - epochMicros) / 1000);
+            System.out.printf ("[T+%.3fms] main() started (System.nanoTime)%n",
+                (mainStartNanos - startNanoTime) / 1_000_000.0);
+        }
+
+        // Launcher phase breakdown (-Djarrunner.phase.<name>.micros)
+        String[] phases = {"exename", "console", "plan", "config", "loginit", "javalookup",
+                           "jdkprobe", "aotname", "aotcleanup", "command"};
+        for (String phase : phases) {
+            String micros = System.getProperty("jarrunner.phase." + phase + ".micros");
+            if (micros != null) {
+                System.out.printf("               %-12s %6s us%n", phase, micros);
+            }
+        }
+
         long timeFromJVMToClassInit = CLASS_INIT_TIME_MS - jvmStartTimeMs;
         long timeFromJVMToMain = mainStartTimeMs - jvmStartTimeMs;
 